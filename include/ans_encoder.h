@@ -14,35 +14,89 @@
 #include "ans_encoder_table.h"
 #include "ans_table_generator.h"
 #include "cuhd_input_buffer.h"
+#include "cuhd_sync_index.h"
 #include "cuhd_definitions.h"
 #include "cuhd_constants.h"
+#include "cuhd_types.h"
 
 #include <memory>
+#include <vector>
 
-struct Decoder_Info {
-    UNIT_TYPE state;
-    size_t bit;
-    
-    // encoded size in units
-    size_t size;
-};
-
-class ANSEncoder {
+template<typename Types>
+class ANSBasicEncoder {
     public:
-        static std::shared_ptr<CUHDInputBuffer> encode(
-            SYMBOL_TYPE* in,
+        typedef typename Types::unit_type unit_type;
+        typedef typename Types::symbol_type symbol_type;
+        typedef ANSBasicEncoderTable<Types> EncoderTable;
+        typedef CUHDBasicInputBuffer<Types> InputBuffer;
+        typedef CUHDBasicSyncIndex<Types> SyncIndex;
+        typedef CUHDBasicSyncCheckpoint<Types> SyncCheckpoint;
+
+        struct Decoder_Info {
+            typename Types::state_type state;
+            size_t bit;
+            
+            // encoded size in units
+            size_t size;
+        };
+
+        static std::shared_ptr<InputBuffer> encode(
+            symbol_type* in,
             size_t size_in,
-            std::shared_ptr<ANSEncoderTable> encoder_table);
+            std::shared_ptr<EncoderTable> encoder_table);
+        
+        // additionally records a checkpoint every checkpoint_interval
+        // units and attaches the resulting CUHDSyncIndex to the buffer
+        static std::shared_ptr<InputBuffer> encode(
+            symbol_type* in,
+            size_t size_in,
+            std::shared_ptr<EncoderTable> encoder_table,
+            size_t checkpoint_interval);
+        
+        // number of units a buffer for encode_into() needs at least,
+        // including the padding required by the decoders
+        static size_t get_buffer_size(
+            std::shared_ptr<EncoderTable> encoder_table,
+            size_t size_in);
+        
+        // encodes into a caller-provided buffer of buffer_size units,
+        // which must be at least get_buffer_size() units large
+        // the units are written directly in decoder order (from the back
+        // of the buffer), the returned CUHDInputBuffer shares the buffer
+        // no temporary buffer is used and nothing is copied or reversed
+        static std::shared_ptr<InputBuffer> encode_into(
+            symbol_type* in,
+            size_t size_in,
+            std::shared_ptr<EncoderTable> encoder_table,
+            size_t checkpoint_interval,
+            std::shared_ptr<unit_type[]> buffer,
+            size_t buffer_size);
     
     private:
+        
+        // unit i is written to out[size_out - 1 - i]
+        // checkpoints are recorded in encoder order: unit, number of bits
+        // already used in the unit and number of symbols encoded so far
         static void encode_memory(
-            UNIT_TYPE* out,
+            unit_type* out,
             size_t size_out,
-            SYMBOL_TYPE* in,
+            symbol_type* in,
             size_t size_in,
-            std::shared_ptr<ANSEncoderTable> encoder_table,
-            std::shared_ptr<Decoder_Info> decoder_info);
+            std::shared_ptr<EncoderTable> encoder_table,
+            std::shared_ptr<Decoder_Info> decoder_info,
+            size_t checkpoint_interval,
+            std::shared_ptr<std::vector<SyncCheckpoint>> checkpoints);
+        
+        // converts checkpoints from encoder order into decoder order
+        static std::shared_ptr<SyncIndex> get_sync_index(
+            std::shared_ptr<std::vector<SyncCheckpoint>> checkpoints,
+            std::shared_ptr<Decoder_Info> decoder_info,
+            size_t size_in,
+            size_t checkpoint_interval);
 };
 
+typedef ANSBasicEncoder<CUHDDefaultTypes> ANSEncoder;
+typedef ANSEncoder::Decoder_Info Decoder_Info;
+
 #endif /* ANS_ENCODER_H_ */
 
@@ -12,25 +12,18 @@
 #define ANS_ENCODER_TABLE_
 
 #include "cuhd_constants.h"
+#include "cuhd_dispatch.h"
+#include "cuhd_types.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
-struct ANSEncoderTable {
-    struct ANSEncoderTableItem {
-        
-        // next state index
-        std::uint32_t next_state;
-        
-        // code sequence to write to output
-        std::uint32_t code_sequence;
-        
-        // length of code sequence
-        std::uint32_t code_length;
-        
-        SYMBOL_TYPE symbol;
-    };
-    
+template<typename Types>
+struct ANSBasicEncoderTable {
+    typedef typename Types::symbol_type symbol_type;
+
     // maximum number of symbols
     size_t max_number_of_symbols;
     
@@ -40,8 +33,50 @@ struct ANSEncoderTable {
     // number of ANS states
     size_t number_of_states;
     
-    // the table
-    std::vector<std::vector<ANSEncoderTableItem>> table;
+    // the table in compact form (FSE style), for a state x in
+    // [number_of_states, 2 * number_of_states) a symbol takes
+    // (x + delta_num_bits) >> 32 bits, which are k or k + 1 depending on x
+    struct ANSSymbolTransform {
+        std::uint64_t delta_num_bits;
+        
+        // x shifted by the number of bits lies in [L_s, 2 * L_s), where L_s
+        // is the number of states of the symbol
+        std::int32_t delta_find_state;
+        
+        // L_s, 0 if the symbol does not occur
+        std::uint32_t num_states;
+    };
+    
+    // one transform per symbol, 16 bytes each
+    std::vector<ANSSymbolTransform> transform;
+    
+    // next states of all symbols, grouped by symbol
+    std::vector<std::uint32_t> next_state;
+    
+    // encodes symbol at state x (not a state index), returns the next state
+    // the codeword is made of the lowest code_length bits of x
+    CUHD_FORCE_INLINE std::uint32_t encode(symbol_type symbol,
+        std::uint32_t x, std::uint32_t& code_length) const {
+        
+        const ANSSymbolTransform& t = transform[symbol];
+        code_length = (x + t.delta_num_bits) >> 32;
+        
+        return next_state[(std::uint32_t) t.delta_find_state
+            + (x >> code_length)];
+    }
+    
+    // longest codeword, taken at the largest state
+    std::uint32_t get_max_code_length() const {
+        const std::uint64_t x = 2 * number_of_states - 1;
+        std::uint32_t max = 0;
+        
+        for(const ANSSymbolTransform& t : transform)
+            max = std::max(max, (std::uint32_t) ((x + t.delta_num_bits) >> 32));
+        
+        return max;
+    }
 };
 
+typedef ANSBasicEncoderTable<CUHDDefaultTypes> ANSEncoderTable;
+
 #endif /* ANS_ENCODER_TABLE */
@@ -0,0 +1,45 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef ANS_INTERLEAVED_ENCODER_
+#define ANS_INTERLEAVED_ENCODER_
+
+#include "ans_encoder_table.h"
+#include "cuhd_interleaved_input_buffer.h"
+#include "cuhd_constants.h"
+#include "cuhd_types.h"
+
+#include <memory>
+#include <vector>
+
+// tANS encoder for interleaved streams, see CUHDInterleavedInputBuffer
+// the codewords are the same as those of ANSEncoder, so the regular
+// decoder table is used for decoding
+template<typename Types>
+class ANSBasicInterleavedEncoder {
+    public:
+        typedef typename Types::symbol_type symbol_type;
+        typedef ANSBasicEncoderTable<Types> EncoderTable;
+        typedef CUHDBasicInterleavedInputBuffer<Types> InterleavedInputBuffer;
+
+        // num_states may be 2, 4 or 8, a checkpoint is recorded about
+        // every checkpoint_interval units
+        static std::shared_ptr<InterleavedInputBuffer> encode(
+            symbol_type* in,
+            size_t size_in,
+            std::shared_ptr<EncoderTable> encoder_table,
+            size_t num_states,
+            size_t checkpoint_interval);
+};
+
+typedef ANSBasicInterleavedEncoder<CUHDDefaultTypes> ANSInterleavedEncoder;
+
+#endif /* ANS_INTERLEAVED_ENCODER_H_ */
+
@@ -15,29 +15,41 @@
 #include "cuhd_definitions.h"
 #include "cuhd_codetable.h"
 #include "ans_encoder_table.h"
+#include "cuhd_types.h"
 
 #include <memory>
 #include <vector>
 #include <functional>
 
-struct Distribution {
-    std::shared_ptr<std::vector<double>> prob;
-    std::shared_ptr<std::vector<size_t>> dist;
-    std::shared_ptr<std::vector<SYMBOL_TYPE>> symbols;
-};
+template<typename Types>
+class ANSBasicTableGenerator {
+    public:
+        typedef typename Types::symbol_type symbol_type;
+        typedef CUHDBasicCodetable<Types> Codetable;
+        typedef ANSBasicEncoderTable<Types> EncoderTable;
 
-struct XS_pair {SYMBOL_TYPE s; std::uint32_t next_state;};
+        struct Distribution {
+            std::shared_ptr<std::vector<double>> prob;
+            std::shared_ptr<std::vector<size_t>> dist;
+            std::shared_ptr<std::vector<symbol_type>> symbols;
+        };
 
-struct Queue_Entry {double p; SYMBOL_TYPE s;};
+        struct XS_pair {symbol_type s; std::uint32_t next_state;};
 
-struct Encoder_Table_Entry {
-    std::uint32_t x;
-    std::uint32_t rem;
-    std::uint32_t shift;
-    SYMBOL_TYPE symbol;};
+        struct Queue_Entry {double p; symbol_type s;};
+
+        // tANS table as a spread of the symbols over the states, state
+        // num_states + i decodes spread[i].s and is reached from the
+        // sub-state spread[i].next_state in [L_s, 2 * L_s) of that symbol
+        struct Symbol_Spread {
+            size_t num_states;
+
+            // largest symbol plus one
+            size_t num_symbols;
+
+            std::vector<XS_pair> spread;
+        };
 
-class ANSTableGenerator {
-    public:
         static Distribution generate_distribution(
             size_t seed,
             size_t n,
@@ -47,32 +59,57 @@ class ANSTableGenerator {
         static Distribution generate_distribution_from_buffer(
             size_t seed,
             size_t N,
-            std::uint8_t* in,
+            symbol_type* in,
             size_t size);
         
-        static std::shared_ptr<std::vector<SYMBOL_TYPE>> generate_test_data(
+        static std::shared_ptr<std::vector<symbol_type>> generate_test_data(
             std::shared_ptr<std::vector<size_t>> distr,
             size_t size,
             size_t num_states,
             size_t seed);
         
-        static std::shared_ptr<std::vector<std::vector<Encoder_Table_Entry>>>
-            generate_table(
+        // num_symbols symbols with L_s states each (symbols 0, 1, ... if
+        // symbols is nullptr), num_symbols <= num_states and at most
+        // Types::max_num_states states (2^16, 2^24 for wide tables),
+        // O(num_states * log(num_symbols))
+        static std::shared_ptr<Symbol_Spread> generate_table(
             std::shared_ptr<std::vector<double>> P_s,
             std::shared_ptr<std::vector<size_t>> L_s,
-            std::shared_ptr<std::vector<SYMBOL_TYPE>> symbols,
+            std::shared_ptr<std::vector<symbol_type>> symbols,
+            size_t num_symbols,
+            size_t num_states);
+        
+        // same spread as generate_table, but every state scans all symbols,
+        // O(num_states * num_symbols), reference for tests and benchmarks
+        static std::shared_ptr<Symbol_Spread> generate_table_linear(
+            std::shared_ptr<std::vector<double>> P_s,
+            std::shared_ptr<std::vector<size_t>> L_s,
+            std::shared_ptr<std::vector<symbol_type>> symbols,
             size_t num_symbols,
             size_t num_states);
             
-        static std::shared_ptr<CUHDCodetable> get_decoder_table(
-            std::shared_ptr<ANSEncoderTable> enc_table);
+        // same states and symbols, and the same spread
+        static bool equals(std::shared_ptr<Symbol_Spread> a,
+            std::shared_ptr<Symbol_Spread> b);
+        
+        // the states are filled by num_threads threads, each taking a
+        // range of symbols, the table does not depend on num_threads
+        static std::shared_ptr<Codetable> get_decoder_table(
+            std::shared_ptr<EncoderTable> enc_table,
+            size_t num_threads = 1);
         
-        static std::shared_ptr<ANSEncoderTable> generate_encoder_table(
-            std::shared_ptr<std::vector<std::vector<Encoder_Table_Entry>>> tab);
+        static std::shared_ptr<EncoderTable> generate_encoder_table(
+            std::shared_ptr<Symbol_Spread> tab);
         
         static size_t get_max_compressed_size(
-            std::shared_ptr<ANSEncoderTable> encoder_table, size_t input_size);
+            std::shared_ptr<EncoderTable> encoder_table, size_t input_size);
 };
 
+typedef ANSBasicTableGenerator<CUHDDefaultTypes> ANSTableGenerator;
+typedef ANSTableGenerator::Distribution Distribution;
+typedef ANSTableGenerator::XS_pair XS_pair;
+typedef ANSTableGenerator::Queue_Entry Queue_Entry;
+typedef ANSTableGenerator::Symbol_Spread Symbol_Spread;
+
 #endif /* ANS_TABLE_GENERATOR_H_ */
 
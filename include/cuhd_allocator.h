@@ -0,0 +1,115 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef CUHD_ALLOCATOR_
+#define CUHD_ALLOCATOR_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// alignment of all allocations (one cache line)
+#define CUHD_ALLOCATOR_ALIGNMENT 64
+
+// source of memory for the buffers, code tables and scratch arrays of the
+// library, memory is never initialised
+class CUHDAllocator {
+    public:
+        virtual ~CUHDAllocator() {}
+
+        virtual void* allocate(size_t bytes) = 0;
+        virtual void deallocate(void* ptr, size_t bytes) = 0;
+
+        // allocator used if none is given, initially a CUHDAlignedAllocator
+        static std::shared_ptr<CUHDAllocator> get_default();
+        static void set_default(std::shared_ptr<CUHDAllocator> allocator);
+
+        // array of num elements which returns to the allocator (the
+        // default allocator if nullptr) once the last reference is gone
+        template<typename T>
+        static std::shared_ptr<T[]> allocate_array(size_t num,
+            std::shared_ptr<CUHDAllocator> allocator = nullptr) {
+
+            static_assert(std::is_trivial<T>::value,
+                "elements are not constructed");
+
+            if(!allocator) allocator = get_default();
+
+            const size_t bytes = num * sizeof(T);
+            T* ptr = static_cast<T*>(allocator->allocate(bytes));
+
+            return std::shared_ptr<T[]>(ptr, [allocator, bytes](T* p) {
+                allocator->deallocate(p, bytes);});
+        }
+};
+
+// CUHD_ALLOCATOR_ALIGNMENT-byte aligned heap memory
+class CUHDAlignedAllocator : public CUHDAllocator {
+    public:
+        void* allocate(size_t bytes) override;
+        void deallocate(void* ptr, size_t bytes) override;
+};
+
+// allocations of at least one huge page are mapped with MAP_HUGETLB if
+// huge pages are reserved, otherwise with madvise(MADV_HUGEPAGE) for
+// transparent huge pages, smaller ones are aligned heap memory
+class CUHDHugePageAllocator : public CUHDAllocator {
+    public:
+        void* allocate(size_t bytes) override;
+        void deallocate(void* ptr, size_t bytes) override;
+
+        // size of a huge page (2 MB)
+        static size_t get_page_size();
+
+    private:
+        CUHDAlignedAllocator small_;
+};
+
+// keeps freed blocks in size classes of four steps per power of two, so
+// that a block is at most a quarter larger than requested, and hands them
+// out again, so repeated decodes of similar size do not allocate
+// blocks are taken from upstream (aligned memory if nullptr)
+class CUHDPoolAllocator : public CUHDAllocator {
+    public:
+        CUHDPoolAllocator(
+            std::shared_ptr<CUHDAllocator> upstream = nullptr);
+        ~CUHDPoolAllocator();
+
+        void* allocate(size_t bytes) override;
+        void deallocate(void* ptr, size_t bytes) override;
+
+        // returns all cached blocks to upstream
+        void release();
+
+        // number of bytes in cached blocks
+        size_t get_cached_size();
+
+    private:
+
+        // index of the size class of a block of the given size
+        static size_t get_size_class(size_t bytes);
+
+        // size of the blocks of a size class
+        static size_t get_class_size(size_t size_class);
+
+        std::shared_ptr<CUHDAllocator> upstream_;
+
+        std::mutex mutex_;
+
+        // free blocks of get_class_size(i) bytes
+        std::vector<std::vector<void*>> free_;
+
+        size_t cached_size_;
+};
+
+#endif /* CUHD_ALLOCATOR_H_ */
+
@@ -0,0 +1,93 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef CUHD_BIT_IO_
+#define CUHD_BIT_IO_
+
+#include "cuhd_dispatch.h"
+#include "cuhd_types.h"
+#include "ans_encoder_table.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// bit writer and reader shared by the encoders and decoders
+namespace cuhd {
+
+    // bit writer holding two units, codewords are appended below the
+    // pending bits, which are kept left-aligned in the register
+    template<typename Types>
+    struct BitWriter {
+        typename Types::window_type bits;
+        std::uint32_t num_bits;
+
+        // next unit, units are written in decoder order (downwards)
+        typename Types::unit_type* out;
+        size_t num_units;
+
+        static const std::uint32_t unit_bits
+            = sizeof(typename Types::unit_type) * 8;
+
+        // one codeword always fits behind unit_bits - 1 pending bits, two
+        // unless the table is wide
+        static const bool pairs = 2 * Types::max_codeword_length <= unit_bits;
+
+        static_assert(Types::max_codeword_length <= unit_bits,
+            "codewords too long");
+    };
+
+    // encodes a symbol, the codeword is made of the lowest bits of x
+    template<typename Types>
+    CUHD_FORCE_INLINE void put_symbol(BitWriter<Types>& w,
+        const ANSBasicEncoderTable<Types>& table,
+        typename Types::symbol_type symbol, std::uint32_t& x) {
+
+        const std::uint32_t last = 2 * BitWriter<Types>::unit_bits - 1;
+
+        std::uint32_t length;
+        const std::uint32_t next = table.encode(symbol, x, length);
+        const typename Types::window_type code = x & ~(~0u << length);
+
+        // a shift by the full register width minus length and num_bits
+        // would be undefined for an empty writer
+        w.bits |= (code << 1) << (last - length - w.num_bits);
+        w.num_bits += length;
+        x = next;
+    }
+
+    // writes the upper unit unconditionally, but moves on to the next
+    // unit only if it is complete
+    template<typename Types>
+    CUHD_FORCE_INLINE size_t flush(BitWriter<Types>& w) {
+        const std::uint32_t unit_bits = BitWriter<Types>::unit_bits;
+
+        *w.out = w.bits >> unit_bits;
+
+        const std::uint32_t full = w.num_bits / unit_bits;
+        w.out -= full;
+        w.bits <<= unit_bits * full;
+        w.num_bits -= unit_bits * full;
+        w.num_units += full;
+
+        return full;
+    }
+
+    // two consecutive units, the first one in the lower half
+    // compilers merge this into a single (unaligned) load
+    template<typename Types>
+    CUHD_FORCE_INLINE typename Types::window_type load_window(
+        const typename Types::unit_type* in) {
+
+        return in[0] | ((typename Types::window_type) in[1]
+            << (sizeof(typename Types::unit_type) * 8));
+    }
+}
+
+#endif /* CUHD_BIT_IO_H_ */
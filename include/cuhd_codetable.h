@@ -11,27 +11,42 @@
 #ifndef CUHD_CODETABLE_
 #define CUHD_CODETABLE_
 
+#include "cuhd_allocator.h"
 #include "cuhd_constants.h"
 #include "cuhd_definitions.h"
+#include "cuhd_types.h"
 
 #include <memory>
 #include <cstring>
 
-struct CUHDCodetableItem {
-    std::uint16_t next_state;
-    std::uint8_t symbol;
+// 4 bytes for 8-bit symbols, 6 bytes for 16-bit symbols, 8 bytes for wide
+// tables
+template<typename Types>
+struct CUHDBasicCodetableItem {
+    typename Types::table_state_type next_state;
+    typename Types::symbol_type symbol;
     std::uint8_t min_num_bits;
 };
 
-class CUHDCodetable {
+template<typename Types>
+class CUHDBasicCodetable {
     public:
-        CUHDCodetable(size_t num_entries);
+        typedef CUHDBasicCodetableItem<Types> Item;
+
+        // the table is taken from allocator (the default allocator if
+        // nullptr)
+        CUHDBasicCodetable(size_t num_entries,
+            std::shared_ptr<CUHDAllocator> allocator = nullptr);
+        
+        // uses table in place, which may be read-only (a mapped file)
+        CUHDBasicCodetable(std::shared_ptr<Item[]> table,
+            size_t num_entries);
 
         size_t get_size();
         size_t get_num_entries();
         size_t get_max_codeword_length();
         
-        CUHDCodetableItem* get();
+        Item* get();
         
     private:
         
@@ -41,8 +56,11 @@ class CUHDCodetable {
         // actual number of items
         size_t num_entries_;
         
-        cuhd_buf(CUHDCodetableItem, table_);
+        cuhd_buf(Item, table_);
 };
 
+typedef CUHDBasicCodetableItem<CUHDDefaultTypes> CUHDCodetableItem;
+typedef CUHDBasicCodetable<CUHDDefaultTypes> CUHDCodetable;
+
 #endif /* CUHD_CODETABLE_H_ */
 
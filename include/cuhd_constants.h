@@ -11,18 +11,32 @@
 #ifndef CUHD_CONSTANTS_
 #define CUHD_CONSTANTS_
 
-// maximum codeword length this implementation can process
-#define MAX_CODEWORD_LENGTH 11
+// maximum codeword length this implementation can process, the length
+// of a symbol with one out of 2^16 states
+#define MAX_CODEWORD_LENGTH 16
+
+// the same for wide decoder tables (up to 2^24 states)
+#define MAX_WIDE_CODEWORD_LENGTH 24
 
 // data type of a unit
 #define UNIT_TYPE std::uint32_t
 
+// number of units behind the compressed data which the decoders may read
+#define INPUT_BUFFER_PADDING 4
+
 // state register type
 #define STATE_TYPE std::uint32_t
 
 // data type of a symbol
 #define SYMBOL_TYPE std::uint8_t
 
+// data type of the states in decoder table items, std::uint32_t for more
+// than 2^16 states
+#define TABLE_STATE_TYPE std::uint16_t
+
+// maximum number of states of an interleaved stream
+#define MAX_INTERLEAVED_STATES 8
+
 // data type for storing the bit length of codewords
 #define BIT_COUNT_TYPE std::uint8_t
 
@@ -0,0 +1,187 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef CUHD_CONTAINER_
+#define CUHD_CONTAINER_
+
+#include "ans_encoder.h"
+#include "ans_table_generator.h"
+#include "cuhd_codetable.h"
+#include "cuhd_input_buffer.h"
+#include "cuhd_mapped_file.h"
+#include "cuhd_types.h"
+#include "multicore_decoder.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// version of the container format, files of other versions are rejected
+#define CUHD_CONTAINER_VERSION 1
+
+// units per subsequence when decoding the blocks of a container
+#define CUHD_CONTAINER_SUBSEQUENCE_SIZE 4
+
+// layout of a container, all offsets in bytes from the start of the file
+// and aligned to CUHD_ALLOCATOR_ALIGNMENT, values in host byte order
+// - header
+// - table: symbols and their normalised counts (std::uint32_t each)
+// - blocks: compressed data of each block in decoder order, followed by
+//   INPUT_BUFFER_PADDING zero units, and its checkpoints if any
+// - block index: one CUHDContainerBlock per block
+// - trailer, at the very end of the file
+struct CUHDContainerHeader {
+
+    // "MULTIANC"
+    char magic[8];
+
+    std::uint32_t version;
+
+    // sizes of the unit, state, symbol and table state types
+    std::uint8_t unit_size;
+    std::uint8_t state_size;
+    std::uint8_t symbol_size;
+    std::uint8_t table_state_size;
+
+    std::uint64_t num_states;
+    std::uint64_t num_table_symbols;
+    std::uint64_t table;
+
+    // uncompressed size in symbols, all blocks but the last one hold
+    // block_size symbols
+    std::uint64_t size;
+    std::uint64_t block_size;
+    std::uint64_t num_blocks;
+
+    // units between two checkpoints, 0 without sync index
+    std::uint64_t checkpoint_interval;
+};
+
+struct CUHDContainerBlock {
+    std::uint64_t offset;
+
+    // compressed size in units, without padding
+    std::uint64_t size;
+
+    std::uint64_t num_symbols;
+
+    std::uint32_t first_state;
+    std::uint32_t first_bit;
+
+    // sync index of the block, 0 if absent
+    std::uint64_t checkpoints;
+    std::uint64_t num_checkpoints;
+};
+
+// CUHDSyncCheckpoint with fixed-size fields
+struct CUHDContainerCheckpoint {
+    std::uint32_t state;
+    std::uint32_t bit;
+    std::uint64_t unit;
+    std::uint64_t output_offset;
+};
+
+struct CUHDContainerTrailer {
+    std::uint64_t block_index;
+
+    // size of the whole file
+    std::uint64_t file_size;
+
+    // "MULTIEND"
+    char magic[8];
+};
+
+// compressed file of independently decodable blocks sharing one table,
+// which is stored as normalised counts
+// the reader maps the file read-only and decodes the blocks in place
+template<typename Types>
+class CUHDBasicContainer {
+    public:
+        typedef typename Types::symbol_type symbol_type;
+        typedef CUHDBasicCodetable<Types> Codetable;
+        typedef ANSBasicEncoderTable<Types> EncoderTable;
+        typedef CUHDBasicInputBuffer<Types> InputBuffer;
+        typedef ANSBasicTableGenerator<Types> Generator;
+        typedef ANSBasicEncoder<Types> Encoder;
+        typedef MulticoreBasicDecoder<Types> Decoder;
+
+        // encodes size symbols with a table of num_states states for the
+        // whole input, in blocks of block_size symbols, num_threads blocks
+        // at a time, with a sync index if checkpoint_interval > 0
+        // returns false on I/O errors
+        static bool write(const std::string& path,
+            symbol_type* in, size_t size,
+            size_t num_states,
+            size_t block_size,
+            size_t checkpoint_interval = 0,
+            size_t num_threads = 1);
+
+        // nullptr if the file cannot be mapped, is truncated, or has a
+        // different version or configuration
+        static std::shared_ptr<CUHDBasicContainer> open(
+            const std::string& path);
+
+        // uncompressed size in symbols
+        size_t get_size();
+        size_t get_num_blocks();
+
+        // index of the first symbol of a block
+        size_t get_block_begin(size_t block);
+        size_t get_block_size(size_t block);
+
+        // reads the compressed data of the blocks [first_block,
+        // first_block + num_blocks) ahead of decoding
+        void prefetch(size_t first_block, size_t num_blocks);
+
+        // compressed data of a block, which points into the mapping and
+        // keeps it alive, with its sync index if there is one
+        std::shared_ptr<InputBuffer> get_block(size_t block);
+
+        // nullptr for empty containers
+        std::shared_ptr<Codetable> get_decoder_table();
+        std::shared_ptr<EncoderTable> get_encoder_table();
+
+        // decodes all get_size() symbols into out in their original order,
+        // blocks are spread over num_threads threads if there are enough of
+        // them, otherwise each block is decoded by num_threads threads
+        void decode(symbol_type* out, size_t num_threads,
+            MulticoreDecoderOptions options = MulticoreDecoderOptions());
+
+        // decodes the blocks [first_block, first_block + num_blocks) into
+        // out, which receives the symbols from get_block_begin(first_block)
+        void decode(size_t first_block, size_t num_blocks,
+            symbol_type* out, size_t num_threads,
+            MulticoreDecoderOptions options = MulticoreDecoderOptions());
+
+        // decodes the symbols [begin, begin + count) into out, only the
+        // blocks of the range are decoded, from the nearest checkpoints if
+        // the blocks have sync indices
+        void decode_range(size_t begin, size_t count, symbol_type* out);
+
+    private:
+        CUHDBasicContainer(std::shared_ptr<CUHDMappedFile> file);
+
+        // checks the header, the trailer and the block index, builds the
+        // tables
+        bool load();
+
+        std::shared_ptr<CUHDMappedFile> file_;
+
+        const CUHDContainerHeader* header_;
+        const CUHDContainerBlock* blocks_;
+
+        std::shared_ptr<Codetable> decoder_table_;
+        std::shared_ptr<EncoderTable> encoder_table_;
+};
+
+typedef CUHDBasicContainer<CUHDDefaultTypes> CUHDContainer;
+
+#endif /* CUHD_CONTAINER_H_ */
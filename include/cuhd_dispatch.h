@@ -0,0 +1,73 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef CUHD_DISPATCH_
+#define CUHD_DISPATCH_
+
+// kernel variants for x86 instruction sets need GCC-style target attributes
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) \
+    && !defined(MULTIANS_NO_SIMD)
+#define MULTIANS_SIMD
+#endif
+
+#ifdef MULTIANS_SIMD
+#define CUHD_TARGET(ISA) __attribute__((target(ISA)))
+#else
+#define CUHD_TARGET(ISA)
+#endif
+
+#ifdef __GNUC__
+#define CUHD_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define CUHD_FORCE_INLINE inline
+#endif
+
+// target strings of the kernel variants
+#define CUHD_TARGET_SSE42 CUHD_TARGET("sse4.2,popcnt")
+#define CUHD_TARGET_AVX2 CUHD_TARGET("avx2,bmi,bmi2,popcnt")
+#define CUHD_TARGET_AVX512 CUHD_TARGET("avx512f,avx512bw,avx2,bmi,bmi2,popcnt")
+
+// kernel variants, ordered by capability
+enum class CUHDInstructionSet {
+    GENERIC = 0,
+    SSE42 = 1,
+    AVX2 = 2,
+    AVX512 = 3
+};
+
+// selects the kernel variant for the hot loops of encoder and decoder
+// the best instruction set of the CPU is detected on first use, the
+// environment variable MULTIANS_ISA (generic, sse4.2, avx2, avx512) may
+// lower it
+class CUHDDispatch {
+    public:
+
+        // instruction set the kernels are currently selected for
+        static CUHDInstructionSet get_instruction_set();
+
+        // best instruction set supported by this CPU
+        static CUHDInstructionSet get_supported_instruction_set();
+
+        // overrides the selection for benchmarks and tests, isa is limited
+        // to what the CPU supports, returns the instruction set selected
+        // must not be called while encoding or decoding
+        static CUHDInstructionSet set_instruction_set(CUHDInstructionSet isa);
+
+        // back to the default selection
+        static void reset_instruction_set();
+
+        static const char* get_name(CUHDInstructionSet isa);
+
+        // returns false if name is not a known instruction set
+        static bool parse(const char* name, CUHDInstructionSet& isa);
+};
+
+#endif /* CUHD_DISPATCH_H_ */
+
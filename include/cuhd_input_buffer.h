@@ -13,22 +13,45 @@
 
 #include <memory>
 
+#include "cuhd_allocator.h"
 #include "cuhd_constants.h"
 #include "cuhd_definitions.h"
+#include "cuhd_sync_index.h"
+#include "cuhd_types.h"
 
-class CUHDInputBuffer {
+template<typename Types>
+class CUHDBasicInputBuffer {
     public:
-	    CUHDInputBuffer(UNIT_TYPE* buffer, size_t size,
-	        size_t first_bit, size_t first_state);
+	    typedef typename Types::unit_type unit_type;
+	    typedef CUHDBasicSyncIndex<Types> SyncIndex;
+
+	    // copies the compressed data in encoder order into a buffer from
+	    // allocator (the default allocator if nullptr)
+	    CUHDBasicInputBuffer(unit_type* buffer, size_t size,
+	        size_t first_bit, size_t first_state,
+	        std::shared_ptr<CUHDAllocator> allocator = nullptr);
+
+	    // takes over a buffer which already holds the compressed data in
+	    // decoder order at the given offset, followed by at least
+	    // INPUT_BUFFER_PADDING readable units (no copy)
+	    // for memory owned elsewhere, e.g. an mmap'd file or a receive
+	    // buffer, pass a shared_ptr whose deleter does nothing (or unmaps
+	    // the region once the last user is gone)
+	    CUHDBasicInputBuffer(std::shared_ptr<unit_type[]> buffer, size_t offset,
+	        size_t size, size_t first_bit, size_t first_state);
 
 	    // returns reference to compressed data
-	    UNIT_TYPE* get_compressed_data();
+	    unit_type* get_compressed_data();
 	    
 	    size_t get_first_bit();
 	    size_t get_first_state();
 	    size_t get_compressed_size();
 	    size_t get_unit_size();
 
+	    // checkpoints recorded by the encoder, nullptr if there are none
+	    std::shared_ptr<SyncIndex> get_sync_index();
+	    void set_sync_index(std::shared_ptr<SyncIndex> index);
+
     private:
 	    
 	    // encoded data begins at this index
@@ -41,11 +64,18 @@ class CUHDInputBuffer {
 	    size_t compressed_size_;
 
 	    // size of a unit
-	    const size_t unit_size_ = sizeof(UNIT_TYPE);
+	    const size_t unit_size_ = sizeof(unit_type);
 	
 	    // buffer containing the compressed input
-	    cuhd_buf(UNIT_TYPE, buffer_);
+	    cuhd_buf(unit_type, buffer_);
+
+	    // index of the first unit of compressed data in buffer_
+	    size_t offset_;
+
+	    std::shared_ptr<SyncIndex> sync_index_;
 };
 
+typedef CUHDBasicInputBuffer<CUHDDefaultTypes> CUHDInputBuffer;
+
 #endif /* CUHD_INPUT_BUFFER_H_ */
 
@@ -0,0 +1,82 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef CUHD_INTERLEAVED_INPUT_BUFFER_
+#define CUHD_INTERLEAVED_INPUT_BUFFER_
+
+#include "cuhd_constants.h"
+#include "cuhd_definitions.h"
+#include "cuhd_input_buffer.h"
+#include "cuhd_types.h"
+
+#include <memory>
+#include <vector>
+
+// position in an interleaved stream at which decoding may start, given in
+// decoder order like CUHDSyncCheckpoint
+template<typename Types>
+struct CUHDBasicInterleavedCheckpoint {
+
+    // decoder states of all interleaved states
+    typename Types::state_type states[MAX_INTERLEAVED_STATES];
+    std::uint32_t bit;
+    size_t unit;
+
+    // number of symbols decoded in front of this position
+    size_t output_offset;
+};
+
+// stream in which several tANS states take turns on the symbols: symbol i
+// is encoded with state i % num_states, all codewords share one bitstream
+// the checkpoints are required for decoding, the first one is the start
+// of the stream
+template<typename Types>
+class CUHDBasicInterleavedInputBuffer {
+    public:
+        typedef CUHDBasicInputBuffer<Types> InputBuffer;
+        typedef CUHDBasicInterleavedCheckpoint<Types> Checkpoint;
+
+        CUHDBasicInterleavedInputBuffer(
+            std::shared_ptr<InputBuffer> stream,
+            size_t num_states,
+            size_t num_symbols,
+            const std::vector<Checkpoint>& checkpoints);
+
+        // compressed data, its first state is the one of the last symbol
+        std::shared_ptr<InputBuffer> get_stream();
+
+        size_t get_num_states();
+
+        // total number of symbols in the stream
+        size_t get_num_symbols();
+
+        size_t get_num_checkpoints();
+        Checkpoint* get_checkpoints();
+
+    private:
+
+        std::shared_ptr<InputBuffer> stream_;
+
+        size_t num_states_;
+
+        size_t num_symbols_;
+
+        size_t num_checkpoints_;
+
+        cuhd_buf(Checkpoint, checkpoints_);
+};
+
+typedef CUHDBasicInterleavedCheckpoint<CUHDDefaultTypes>
+    CUHDInterleavedCheckpoint;
+typedef CUHDBasicInterleavedInputBuffer<CUHDDefaultTypes>
+    CUHDInterleavedInputBuffer;
+
+#endif /* CUHD_INTERLEAVED_INPUT_BUFFER_H_ */
+
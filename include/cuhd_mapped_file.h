@@ -0,0 +1,45 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef CUHD_MAPPED_FILE_
+#define CUHD_MAPPED_FILE_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// read-only shared mapping of a whole file, processes mapping the same
+// file share its pages through the page cache
+class CUHDMappedFile {
+    public:
+        ~CUHDMappedFile();
+
+        // nullptr if the file cannot be opened or mapped
+        static std::shared_ptr<CUHDMappedFile> open(const std::string& path);
+
+        // nullptr for empty files
+        const std::uint8_t* get();
+        size_t get_size();
+
+        // reads the pages of [offset, offset + size) ahead of their use
+        void prefetch(size_t offset, size_t size);
+
+    private:
+        CUHDMappedFile(void* data, size_t size);
+
+        CUHDMappedFile(const CUHDMappedFile&) = delete;
+        CUHDMappedFile& operator=(const CUHDMappedFile&) = delete;
+
+        void* data_;
+        size_t size_;
+};
+
+#endif /* CUHD_MAPPED_FILE_H_ */
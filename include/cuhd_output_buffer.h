@@ -11,17 +11,33 @@
 #ifndef CUHD_OUTPUT_BUFFER_
 #define CUHD_OUTPUT_BUFFER_
 
+#include "cuhd_allocator.h"
 #include "cuhd_constants.h"
 #include "cuhd_definitions.h"
+#include "cuhd_types.h"
 
 #include <memory>
 
-class CUHDOutputBuffer {
+template<typename Types>
+class CUHDBasicOutputBuffer {
     public:
-	    CUHDOutputBuffer(size_t size);
+	    typedef typename Types::symbol_type symbol_type;
+
+	    // allocates size symbols from allocator (the default allocator if
+	    // nullptr), the buffer is not initialised
+	    CUHDBasicOutputBuffer(size_t size,
+	        std::shared_ptr<CUHDAllocator> allocator = nullptr);
+
+	    // writes into size symbols of caller memory (e.g. a column of a
+	    // pre-allocated store), which is neither owned nor initialised
+	    CUHDBasicOutputBuffer(symbol_type* buffer, size_t size);
+
+	    // shares a buffer of at least size symbols with the caller
+	    CUHDBasicOutputBuffer(std::shared_ptr<symbol_type[]> buffer,
+	        size_t size);
 	
 	    // returns reference to uncompressed data
-	    std::shared_ptr<SYMBOL_TYPE[]>& get_decompressed_data();
+	    std::shared_ptr<symbol_type[]>& get_decompressed_data();
 
         void reverse();
 	    size_t get_uncompressed_size();
@@ -32,11 +48,13 @@ class CUHDOutputBuffer {
 	    size_t uncompressed_size_;
 
 	    // size of a symbol in bytes
-	    const size_t symbol_size_ = sizeof(SYMBOL_TYPE);
+	    const size_t symbol_size_ = sizeof(symbol_type);
 
 	    // buffer containing the decompressed output
-	    cuhd_out_buf(SYMBOL_TYPE, buffer_);
+	    cuhd_out_buf(symbol_type, buffer_);
 };
 
+typedef CUHDBasicOutputBuffer<CUHDDefaultTypes> CUHDOutputBuffer;
+
 #endif /* CUHD_OUTPUT_BUFFER_H_ */
 
@@ -0,0 +1,74 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef CUHD_SYNC_INDEX_
+#define CUHD_SYNC_INDEX_
+
+#include "cuhd_constants.h"
+#include "cuhd_definitions.h"
+#include "cuhd_types.h"
+
+#include <memory>
+#include <vector>
+
+// position in the compressed stream at which decoding may start,
+// given in decoder order (units as stored in CUHDInputBuffer)
+template<typename Types>
+struct CUHDBasicSyncCheckpoint {
+
+    // decoder state before the codeword starting at this position
+    typename Types::state_type state;
+    std::uint32_t bit;
+    size_t unit;
+
+    // number of symbols decoded in front of this position
+    size_t output_offset;
+};
+
+// checkpoints recorded by the encoder, sorted by position
+// the first checkpoint is the start of the stream
+template<typename Types>
+class CUHDBasicSyncIndex {
+    public:
+        typedef CUHDBasicSyncCheckpoint<Types> Checkpoint;
+
+        CUHDBasicSyncIndex(const std::vector<Checkpoint>& checkpoints,
+            size_t interval, size_t num_symbols);
+
+        size_t get_num_checkpoints();
+
+        // total number of symbols in the stream
+        size_t get_num_symbols();
+
+        // distance between checkpoints in units
+        size_t get_interval();
+
+        // returns the last checkpoint with an output offset not larger
+        // than output_position
+        size_t find(size_t output_position);
+
+        Checkpoint* get();
+
+    private:
+
+        size_t num_checkpoints_;
+
+        size_t interval_;
+
+        size_t num_symbols_;
+
+        cuhd_buf(Checkpoint, checkpoints_);
+};
+
+typedef CUHDBasicSyncCheckpoint<CUHDDefaultTypes> CUHDSyncCheckpoint;
+typedef CUHDBasicSyncIndex<CUHDDefaultTypes> CUHDSyncIndex;
+
+#endif /* CUHD_SYNC_INDEX_H_ */
+
@@ -0,0 +1,126 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef CUHD_TABLE_FILE_
+#define CUHD_TABLE_FILE_
+
+#include "ans_encoder_table.h"
+#include "ans_table_generator.h"
+#include "cuhd_codetable.h"
+#include "cuhd_mapped_file.h"
+#include "cuhd_types.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// version of the table file format, files of other versions are rejected
+#define CUHD_TABLE_FILE_VERSION 1
+
+// contents of a table file
+#define CUHD_TABLE_FILE_COUNTS 0
+#define CUHD_TABLE_FILE_PACKED 1
+
+// a table file starts with this header, followed by its sections, each at
+// an offset aligned to CUHD_ALLOCATOR_ALIGNMENT bytes
+// - counts: symbols and their normalised counts (std::uint32_t each), the
+//   tables are rebuilt when the file is opened
+// - packed: decoder items, encoder transforms and next states, as stored
+//   in memory, the decoder table is used in place
+// all values are stored in host byte order
+struct CUHDTableFileHeader {
+
+    // "MULTIANS"
+    char magic[8];
+
+    std::uint32_t version;
+    std::uint32_t contents;
+
+    // configuration, files are opened with the same configuration only
+    std::uint8_t unit_size;
+    std::uint8_t state_size;
+    std::uint8_t symbol_size;
+    std::uint8_t table_state_size;
+    std::uint16_t item_size;
+
+    std::uint64_t num_states;
+
+    // counted symbols (counts), largest symbol plus one (packed)
+    std::uint64_t num_symbols;
+
+    // size of the whole file
+    std::uint64_t file_size;
+
+    // offsets of the sections, 0 if absent
+    std::uint64_t symbols;
+    std::uint64_t counts;
+    std::uint64_t items;
+    std::uint64_t transforms;
+    std::uint64_t next_states;
+};
+
+// encoder and decoder tables stored in a file, which is mapped read-only,
+// so that decoders start without building tables and processes opening the
+// same file share the pages of the decoder table
+template<typename Types>
+class CUHDBasicTableFile {
+    public:
+        typedef typename Types::symbol_type symbol_type;
+        typedef CUHDBasicCodetable<Types> Codetable;
+        typedef ANSBasicEncoderTable<Types> EncoderTable;
+        typedef ANSBasicTableGenerator<Types> Generator;
+
+        // writes the packed tables, returns false on I/O errors
+        static bool write(const std::string& path,
+            std::shared_ptr<EncoderTable> encoder_table,
+            std::shared_ptr<Codetable> decoder_table);
+
+        // writes the counts of a distribution (symbols 0, 1, ... if
+        // symbols is nullptr), which sum up to the number of states
+        static bool write(const std::string& path,
+            std::shared_ptr<std::vector<size_t>> counts,
+            std::shared_ptr<std::vector<symbol_type>> symbols);
+
+        // nullptr if the file cannot be mapped, is truncated, or has a
+        // different version or configuration
+        static std::shared_ptr<CUHDBasicTableFile> open(
+            const std::string& path);
+
+        // CUHD_TABLE_FILE_COUNTS or CUHD_TABLE_FILE_PACKED
+        std::uint32_t get_contents();
+
+        size_t get_num_states();
+
+        // the table of a packed file is read-only, it keeps the mapping
+        // alive
+        std::shared_ptr<Codetable> get_decoder_table();
+
+        // the table of a packed file is copied on each call
+        std::shared_ptr<EncoderTable> get_encoder_table();
+
+    private:
+        CUHDBasicTableFile(std::shared_ptr<CUHDMappedFile> file);
+
+        // checks the header and the sections
+        bool load();
+
+        std::shared_ptr<CUHDMappedFile> file_;
+
+        const CUHDTableFileHeader* header_;
+
+        // tables built from counts, or the mapped decoder table
+        std::shared_ptr<Codetable> decoder_table_;
+        std::shared_ptr<EncoderTable> encoder_table_;
+};
+
+typedef CUHDBasicTableFile<CUHDDefaultTypes> CUHDTableFile;
+
+#endif /* CUHD_TABLE_FILE_H_ */
@@ -0,0 +1,95 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef CUHD_TYPES_
+#define CUHD_TYPES_
+
+#include "cuhd_constants.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// integer of twice the size of a unit
+template<size_t UNIT_SIZE> struct CUHDWindow;
+template<> struct CUHDWindow<4> {typedef std::uint64_t type;};
+template<> struct CUHDWindow<8> {typedef unsigned __int128 type;};
+
+// configuration of a codec, the template parameter of the CUHDBasic*,
+// ANSBasic* and MulticoreBasic* classes
+template<typename UNIT, typename STATE, typename SYMBOL,
+    typename TABLE_STATE = std::uint16_t>
+struct CUHDTypes {
+    typedef UNIT unit_type;
+    typedef STATE state_type;
+    typedef SYMBOL symbol_type;
+
+    // state stored in decoder table items (std::uint32_t for wide tables)
+    typedef TABLE_STATE table_state_type;
+
+    // register holding a unit and its successor (bit readers and writers)
+    typedef typename CUHDWindow<sizeof(UNIT)>::type window_type;
+
+    // longest codeword, the one of a symbol with a single state, and
+    // largest number of states
+    static const std::uint32_t max_codeword_length
+        = sizeof(TABLE_STATE) == 2 ? MAX_CODEWORD_LENGTH
+        : MAX_WIDE_CODEWORD_LENGTH;
+    static const size_t max_num_states = (size_t) 1 << max_codeword_length;
+};
+
+// configurations compiled into the library: 8-bit symbols (text) and
+// 16-bit symbols (dictionary ids) with 32-bit and 64-bit units, and wide
+// tables of more than 2^16 states for 32-bit units
+typedef CUHDTypes<std::uint32_t, std::uint32_t, std::uint8_t>
+    CUHDUnit32Symbol8;
+typedef CUHDTypes<std::uint32_t, std::uint32_t, std::uint16_t>
+    CUHDUnit32Symbol16;
+typedef CUHDTypes<std::uint64_t, std::uint32_t, std::uint8_t>
+    CUHDUnit64Symbol8;
+typedef CUHDTypes<std::uint64_t, std::uint32_t, std::uint16_t>
+    CUHDUnit64Symbol16;
+typedef CUHDTypes<std::uint32_t, std::uint32_t, std::uint8_t, std::uint32_t>
+    CUHDUnit32Symbol8Wide;
+typedef CUHDTypes<std::uint32_t, std::uint32_t, std::uint16_t, std::uint32_t>
+    CUHDUnit32Symbol16Wide;
+
+// calls MACRO with each of the configurations above
+#define CUHD_FOR_EACH_TYPES(MACRO) \
+    MACRO(CUHDUnit32Symbol8) \
+    MACRO(CUHDUnit32Symbol16) \
+    MACRO(CUHDUnit64Symbol8) \
+    MACRO(CUHDUnit64Symbol16) \
+    MACRO(CUHDUnit32Symbol8Wide) \
+    MACRO(CUHDUnit32Symbol16Wide)
+
+// instantiates a class template for each of the configurations above
+#define CUHD_INSTANTIATE(TEMPLATE) \
+    template class TEMPLATE<CUHDUnit32Symbol8>; \
+    template class TEMPLATE<CUHDUnit32Symbol16>; \
+    template class TEMPLATE<CUHDUnit64Symbol8>; \
+    template class TEMPLATE<CUHDUnit64Symbol16>; \
+    template class TEMPLATE<CUHDUnit32Symbol8Wide>; \
+    template class TEMPLATE<CUHDUnit32Symbol16Wide>;
+
+// configuration of the plain names (CUHDCodetable, ANSEncoder, ...)
+typedef CUHDTypes<UNIT_TYPE, STATE_TYPE, SYMBOL_TYPE, TABLE_STATE_TYPE>
+    CUHDDefaultTypes;
+
+static_assert(std::is_same<CUHDDefaultTypes, CUHDUnit32Symbol8>::value
+    || std::is_same<CUHDDefaultTypes, CUHDUnit32Symbol16>::value
+    || std::is_same<CUHDDefaultTypes, CUHDUnit64Symbol8>::value
+    || std::is_same<CUHDDefaultTypes, CUHDUnit64Symbol16>::value
+    || std::is_same<CUHDDefaultTypes, CUHDUnit32Symbol8Wide>::value
+    || std::is_same<CUHDDefaultTypes, CUHDUnit32Symbol16Wide>::value,
+    "UNIT_TYPE, STATE_TYPE, SYMBOL_TYPE and TABLE_STATE_TYPE are not "
+    "instantiated");
+
+#endif /* CUHD_TYPES_H_ */
@@ -32,7 +32,8 @@ namespace cuhd {
             #define TIMER_STOP }));
             
             // returns true if arrays equal, false otherwise        
-            static bool equals(SYMBOL_TYPE* a, SYMBOL_TYPE* b, size_t size);
+            template<typename SYMBOL>
+            static bool equals(SYMBOL* a, SYMBOL* b, size_t size);
 
             // save integer division
             #define SDIV(n, m) ((n + m - 1) / m)
@@ -9,13 +9,21 @@
  *****************************************************************************/
 
 #include "cuhd_constants.h"
+#include "cuhd_types.h"
+#include "cuhd_allocator.h"
 #include "cuhd_codetable.h"
 #include "cuhd_input_buffer.h"
+#include "cuhd_interleaved_input_buffer.h"
 #include "cuhd_output_buffer.h"
+#include "cuhd_sync_index.h"
 #include "cuhd_util.h"
+#include "cuhd_dispatch.h"
+#include "cuhd_mapped_file.h"
 #include "ans_encoder_table.h"
 #include "ans_table_generator.h"
 #include "ans_encoder.h"
+#include "ans_interleaved_encoder.h"
+#include "cuhd_table_file.h"
 
 #ifdef CUDA
 #include "cuhd_gpu_codetable.h"
@@ -27,4 +35,7 @@
 
 #ifdef MULTI
 #include "multicore_decoder.h"
+#include "multicore_decoder_session.h"
+#include "multicore_stream_decoder.h"
+#include "cuhd_container.h"
 #endif
@@ -8,48 +8,159 @@
  *
  *****************************************************************************/
 
+#include "cuhd_allocator.h"
 #include "cuhd_constants.h"
+#include "cuhd_dispatch.h"
 #include "cuhd_codetable.h"
 #include "cuhd_input_buffer.h"
+#include "cuhd_interleaved_input_buffer.h"
 #include "cuhd_output_buffer.h"
+#include "cuhd_sync_index.h"
+#include "cuhd_types.h"
 #include "cuhd_util.h"
 #include "ans_encoder_table.h"
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 #ifndef MULTICORE_DECODER_
 #define MULTICORE_DECODER_
 
-struct SubsequenceSyncPoint {
-    UNIT_TYPE state;
-    std::uint32_t bit;
-    std::uint32_t unit;
-    std::uint32_t num_symbols;
-};
-
 struct DecoderInterval {
     size_t begin;
     size_t end;
     size_t sub;
 };
 
-class MulticoreDecoder {
+// strategy for finding the synchronisation points between threads
+enum class MulticoreSyncMode {
+
+    // each thread owns a fixed interval, unsynchronised intervals are
+    // decoded again in rounds until all of them are synchronised
+    ROUNDS,
+
+    // subsequences are grouped into small tasks on per-thread queues,
+    // idle threads steal pending tasks and sync is tracked per task
+    WORK_STEALING,
+
+    // one interval per thread, but no rounds: each thread publishes its
+    // boundary through atomic flags and its successor verifies as soon as
+    // the boundary is available (wavefront instead of barriers)
+    PIPELINED
+};
+
+struct MulticoreDecoderOptions {
+    MulticoreSyncMode sync_mode = MulticoreSyncMode::ROUNDS;
+
+    // number of subsequences per task (WORK_STEALING only)
+    size_t subsequences_per_task = 32;
+
+    // keep the symbols of phase 1 and only decode the subsequences in
+    // front of each thread's sync point again when writing the output,
+    // the rest is copied (ROUNDS and PIPELINED only, needs about one
+    // extra output buffer of memory), threads whose symbols do not fit
+    // decode their interval again, see
+    // MulticoreDecoderSession::get_num_speculative_fallbacks
+    bool speculative_write = false;
+
+    // start threads at the checkpoints of the input's CUHDSyncIndex
+    // (if present) instead of synchronising them
+    bool use_sync_index = true;
+
+    // decode several tasks at once in SIMD lanes during phase 1 if AVX2
+    // or AVX-512 kernels are selected (WORK_STEALING only)
+    bool simd_phase1 = true;
+
+    // write the symbols in their original order, no reverse() required
+    // afterwards (the decoders produce them last to first)
+    bool forward_output = false;
+
+    // source of the scratch buffers (the default allocator if nullptr)
+    std::shared_ptr<CUHDAllocator> allocator;
+};
+
+template<typename Types>
+class MulticoreBasicDecoderSession;
+
+template<typename Types>
+class MulticoreBasicDecoder {
+    friend class MulticoreBasicDecoderSession<Types>;
+
     public:
+        typedef typename Types::state_type state_type;
+        typedef typename Types::symbol_type symbol_type;
+        typedef CUHDBasicCodetable<Types> Codetable;
+        typedef CUHDBasicInputBuffer<Types> InputBuffer;
+        typedef CUHDBasicOutputBuffer<Types> OutputBuffer;
+        typedef CUHDBasicInterleavedInputBuffer<Types> InterleavedInputBuffer;
+        typedef CUHDBasicSyncIndex<Types> SyncIndex;
+        typedef CUHDBasicSyncCheckpoint<Types> SyncCheckpoint;
+        typedef CUHDBasicInterleavedCheckpoint<Types> InterleavedCheckpoint;
+
+        struct SubsequenceSyncPoint {
+            state_type state;
+            std::uint32_t bit;
+            std::uint32_t unit;
+            std::uint32_t num_symbols;
+        };
+
+        // symbols of a thread's interval as decoded in phase 1, kept for
+        // the write pass (speculative write mode)
+        struct SpeculativeOutput {
+            std::shared_ptr<symbol_type[]> symbols;
+            size_t capacity;
+
+            // number of symbols decoded in phase 1
+            size_t size;
+
+            // number of leading subsequences of the interval which have
+            // been decoded from a wrong start point and have to be
+            // decoded again
+            size_t num_invalid;
+
+            // false if the thread never synchronised or ran out of
+            // capacity
+            bool valid;
+        };
+
         static void decode(
             size_t subsequence_size,
             size_t num_threads,
             size_t input_size_units,
-            std::shared_ptr<CUHDOutputBuffer> out,
-            std::shared_ptr<CUHDInputBuffer> in,
-            std::shared_ptr<CUHDCodetable> tab);
+            std::shared_ptr<OutputBuffer> out,
+            std::shared_ptr<InputBuffer> in,
+            std::shared_ptr<Codetable> tab,
+            MulticoreDecoderOptions options = MulticoreDecoderOptions());
+        
+        // decodes the symbols [begin_symbol, begin_symbol + count) of a
+        // stream with a sync index into out, in their original order
+        // only the units following the nearest checkpoint are decoded
+        static void decode_range(
+            std::shared_ptr<InputBuffer> in,
+            std::shared_ptr<Codetable> tab,
+            size_t begin_symbol,
+            size_t count,
+            symbol_type* out);
+        
+        // decodes an interleaved stream, the threads start at its
+        // checkpoints, the output order is the same as for decode()
+        static void decode_interleaved(
+            size_t num_threads,
+            std::shared_ptr<OutputBuffer> out,
+            std::shared_ptr<InterleavedInputBuffer> in,
+            std::shared_ptr<Codetable> tab,
+            MulticoreDecoderOptions options = MulticoreDecoderOptions());
     
     private:
-        static std::vector<DecoderInterval> get_decoder_intervals(
+        static void get_decoder_intervals(
             size_t subsequence_size,
             size_t num_threads,
-            size_t input_size_units);
+            size_t input_size_units,
+            std::vector<DecoderInterval>& vals);
     
+        // the overflow and write passes start at start, or at the sync
+        // point in front of the interval if start is nullptr
         static void decode_phase1(
             size_t thread_id,
             size_t begin,
@@ -59,14 +170,76 @@ class MulticoreDecoder {
             size_t num_units,
             size_t num_threads,
             std::shared_ptr<size_t[]> out_positions,
-            std::shared_ptr<CUHDOutputBuffer> out,
-            std::shared_ptr<CUHDInputBuffer> in,
-            std::shared_ptr<CUHDCodetable> tab,
+            std::shared_ptr<OutputBuffer> out,
+            std::shared_ptr<InputBuffer> in,
+            std::shared_ptr<Codetable> tab,
             std::shared_ptr<SubsequenceSyncPoint[]> sync_info,
             std::shared_ptr<std::vector<size_t>> thread_synced,
             bool overflow,
-            bool write);
+            bool write,
+            SpeculativeOutput* speculative,
+            bool forward,
+            const SubsequenceSyncPoint* start = nullptr);
             
+        // decodes num_symbols symbols starting at a checkpoint, the first
+        // skip symbols are not written, forward writes them into
+        // [out, out + num_symbols) in their original order
+        static void decode_checkpoint(
+            const SyncCheckpoint& checkpoint,
+            size_t skip,
+            size_t num_symbols,
+            symbol_type* out,
+            std::shared_ptr<InputBuffer> in,
+            std::shared_ptr<Codetable> tab,
+            bool forward);
+        
+        // decodes num_symbols symbols of an interleaved stream starting at
+        // one of its checkpoints
+        static void decode_interleaved_checkpoint(
+            const InterleavedCheckpoint& checkpoint,
+            size_t num_symbols,
+            symbol_type* out,
+            std::shared_ptr<InterleavedInputBuffer> in,
+            std::shared_ptr<Codetable> tab,
+            bool forward);
+            
+        // number of intervals decode_phase1_simd processes at once with
+        // the selected instruction set, 1 if there is no vectorised kernel
+        static size_t get_phase1_lanes();
+        
+        // phase 1 for up to get_phase1_lanes() intervals at once, one
+        // interval per lane, the sync points are identical to those of
+        // decode_phase1, interval 0 starts at the beginning of the stream
+        static void decode_phase1_simd(
+            const size_t* ids,
+            size_t num_lanes,
+            const std::vector<DecoderInterval>& intervals,
+            size_t subsequence_size,
+            std::shared_ptr<InputBuffer> in,
+            std::shared_ptr<Codetable> tab,
+            std::shared_ptr<SubsequenceSyncPoint[]> sync_info);
+        
+        // gcc takes the target of a member template from its declaration
+        #ifdef MULTIANS_SIMD
+        CUHD_TARGET_AVX2 static void decode_phase1_avx2(
+            const size_t* ids,
+            size_t num_lanes,
+            const std::vector<DecoderInterval>& intervals,
+            size_t subsequence_size,
+            std::shared_ptr<InputBuffer> in,
+            std::shared_ptr<Codetable> tab,
+            std::shared_ptr<SubsequenceSyncPoint[]> sync_info);
+        
+        CUHD_TARGET_AVX512 static void decode_phase1_avx512(
+            const size_t* ids,
+            size_t num_lanes,
+            const std::vector<DecoderInterval>& intervals,
+            size_t subsequence_size,
+            std::shared_ptr<InputBuffer> in,
+            std::shared_ptr<Codetable> tab,
+            std::shared_ptr<SubsequenceSyncPoint[]> sync_info);
+        #endif
+        
         static void prefix_sum(
             std::shared_ptr<SubsequenceSyncPoint[]> sync_info,
             std::shared_ptr<size_t[]> out_positions,
@@ -74,4 +247,8 @@ class MulticoreDecoder {
             size_t num_threads);
 };
 
+typedef MulticoreBasicDecoder<CUHDDefaultTypes> MulticoreDecoder;
+typedef MulticoreDecoder::SubsequenceSyncPoint SubsequenceSyncPoint;
+typedef MulticoreDecoder::SpeculativeOutput SpeculativeOutput;
+
 #endif /* MULTICORE_DECODER_H_ */
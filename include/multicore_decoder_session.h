@@ -0,0 +1,244 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef MULTICORE_DECODER_SESSION_
+#define MULTICORE_DECODER_SESSION_
+
+#include "multicore_decoder.h"
+
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// stateful variant of MulticoreDecoder for back-to-back decodes
+// worker threads are created once and parked between passes, scratch
+// buffers only grow, so repeated calls to decode() neither spawn threads
+// nor allocate (once the largest input has been seen)
+template<typename Types>
+class MulticoreBasicDecoderSession {
+    public:
+        typedef MulticoreBasicDecoder<Types> Decoder;
+        typedef typename Decoder::Codetable Codetable;
+        typedef typename Decoder::InputBuffer InputBuffer;
+        typedef typename Decoder::OutputBuffer OutputBuffer;
+        typedef typename Decoder::InterleavedInputBuffer
+            InterleavedInputBuffer;
+
+        MulticoreBasicDecoderSession(size_t num_threads,
+            MulticoreDecoderOptions options = MulticoreDecoderOptions());
+        ~MulticoreBasicDecoderSession();
+
+        MulticoreBasicDecoderSession(
+            const MulticoreBasicDecoderSession&) = delete;
+        MulticoreBasicDecoderSession& operator=(
+            const MulticoreBasicDecoderSession&) = delete;
+
+        void decode(
+            size_t subsequence_size,
+            size_t input_size_units,
+            std::shared_ptr<OutputBuffer> out,
+            std::shared_ptr<InputBuffer> in,
+            std::shared_ptr<Codetable> tab);
+
+        // see MulticoreDecoder::decode_interleaved
+        void decode_interleaved(
+            std::shared_ptr<OutputBuffer> out,
+            std::shared_ptr<InterleavedInputBuffer> in,
+            std::shared_ptr<Codetable> tab);
+
+        // decodes one window of a longer stream in two steps, see
+        // MulticoreStreamDecoder (ROUNDS mode, no sync index): the threads
+        // are synchronised on the first input_size_units units of in, a
+        // multiple of subsequence_size, which must be followed by at least
+        // INPUT_BUFFER_PADDING units of the stream
+        // returns the number of symbols whose codewords start in the window,
+        // last is the sync point of the last of them
+        size_t synchronise_window(
+            size_t subsequence_size,
+            size_t input_size_units,
+            std::shared_ptr<InputBuffer> in,
+            std::shared_ptr<Codetable> tab,
+            typename Decoder::SubsequenceSyncPoint& last);
+
+        // writes the symbols of the window synchronised last into out, which
+        // holds exactly as many symbols as synchronise_window returned
+        void write_window(std::shared_ptr<OutputBuffer> out);
+
+        size_t get_num_threads();
+
+        // number of thread intervals whose phase 1 symbols did not fit into
+        // the speculative buffer and were decoded again in full since the
+        // session was created (speculative_write only), the buffer of such
+        // a thread grows to the number of symbols it decoded
+        size_t get_num_speculative_fallbacks();
+
+        MulticoreDecoderOptions get_options();
+        void set_options(MulticoreDecoderOptions options);
+
+    private:
+        typedef typename Decoder::SubsequenceSyncPoint SubsequenceSyncPoint;
+        typedef typename Decoder::SpeculativeOutput SpeculativeOutput;
+
+        enum class Pass {
+
+            // one interval per thread
+            PHASE1,
+            OVERFLOW,
+            WRITE,
+
+            // phase 1 followed by pipelined verification
+            PIPELINED,
+
+            // intervals (tasks) are taken from the queues
+            TASK_PHASE1,
+            TASK_SYNC,
+            TASK_WRITE,
+
+            // threads start at the checkpoints of a sync index
+            INDEXED,
+
+            // threads start at the checkpoints of an interleaved stream
+            INTERLEAVED
+        };
+
+        // range of tasks owned by a thread, thieves take from the back
+        struct TaskQueue {
+            std::mutex mutex;
+            size_t begin;
+            size_t end;
+        };
+
+        void decode_rounds(size_t num_subsequences);
+
+        // phase 1 and overflow rounds until all threads are synchronised
+        void synchronise_rounds();
+
+        void decode_tasks(size_t num_subsequences);
+        void decode_pipelined(size_t num_subsequences);
+        void decode_indexed();
+
+        // runs one pass over all threads and blocks until it is done
+        // the calling thread acts as thread 0
+        void run(Pass pass);
+
+        // main loop of a parked worker
+        void work(size_t thread_id);
+
+        // processes the share of a single thread in the current pass
+        void execute(size_t thread_id);
+
+        // phase 1 and verification of a thread in PIPELINED mode
+        void pipeline(size_t thread_id);
+
+        // stores the start point of the successor of a thread in
+        // boundary_, the thread wrote it itself
+        void publish_boundary(size_t thread_id);
+
+        // start point packed into 64 bits: state (25 bits, below
+        // 2 * Types::max_num_states), bit (7 bits) and unit (32 bits)
+        static std::uint64_t pack_boundary(const SubsequenceSyncPoint& sp);
+        static SubsequenceSyncPoint unpack_boundary(std::uint64_t packed);
+
+        // spreads the tasks [first, num_tasks_) over the queues
+        void fill_queues(size_t first);
+
+        // takes a task from the own queue or steals one
+        bool next_task(size_t thread_id, size_t& task);
+
+        // phase 1 of WORK_STEALING with several tasks per SIMD kernel call
+        void decode_tasks_simd(size_t thread_id);
+
+        // verifies a task which has been claimed by the calling thread
+        void sync_task(size_t task);
+
+        // grows scratch buffers if necessary
+        void reserve(size_t num_subsequences, size_t num_tasks);
+
+        // grows the phase 1 output buffers of the speculative write mode
+        void reserve_speculative(size_t output_size);
+
+        // after a write pass, grows the phase 1 output buffers of the
+        // threads whose symbols did not fit and counts them
+        void update_speculative();
+
+        // phase 1 output buffer of a thread, nullptr if not speculating
+        SpeculativeOutput* get_speculative(size_t thread_id);
+
+        const size_t num_threads_;
+
+        MulticoreDecoderOptions options_;
+
+        // worker threads 1 ... num_threads_ - 1
+        std::vector<std::thread> workers_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+
+        // incremented for each pass, wakes up the workers
+        size_t generation_;
+
+        // number of workers that have not finished the current pass
+        size_t num_pending_;
+
+        bool shutdown_;
+
+        // parameters of the current pass
+        Pass pass_;
+        size_t subsequence_size_;
+        size_t input_size_units_;
+        std::shared_ptr<OutputBuffer> out_;
+        std::shared_ptr<InputBuffer> in_;
+        std::shared_ptr<Codetable> tab_;
+        std::vector<DecoderInterval> intervals_;
+        std::shared_ptr<typename Decoder::SyncIndex> sync_index_;
+        std::shared_ptr<InterleavedInputBuffer> interleaved_in_;
+
+        // scratch buffers
+        size_t sync_info_size_;
+        std::shared_ptr<SubsequenceSyncPoint[]> sync_info_;
+        std::shared_ptr<size_t[]> out_positions_;
+        std::shared_ptr<std::vector<size_t>> thread_synced_;
+
+        // per thread flags for PIPELINED, the version is incremented each
+        // time the thread rewrote the start point of its successor (1 after
+        // phase 1), final is set once it is verified for good
+        std::unique_ptr<std::atomic<size_t>[]> boundary_version_;
+        std::unique_ptr<std::atomic<bool>[]> boundary_final_;
+
+        // start point of the successor as published with the version, its
+        // sync point in sync_info_ may be rewritten at the same time
+        std::unique_ptr<std::atomic<std::uint64_t>[]> boundary_;
+
+        // per thread phase 1 output for speculative writing
+        std::vector<SpeculativeOutput> speculative_;
+        size_t num_speculative_fallbacks_;
+
+        // scratch buffers for WORK_STEALING, indexed by task
+        size_t num_tasks_;
+        size_t tasks_size_;
+        std::vector<DecoderInterval> tasks_;
+        std::shared_ptr<size_t[]> task_out_positions_;
+        std::shared_ptr<std::vector<size_t>> task_synced_;
+        std::unique_ptr<std::atomic<std::uint8_t>[]> task_state_;
+        std::unique_ptr<TaskQueue[]> queues_;
+
+        // tasks per call of the vectorised phase 1, 1 if it is not used
+        size_t simd_lanes_;
+};
+
+typedef MulticoreBasicDecoderSession<CUHDDefaultTypes> MulticoreDecoderSession;
+
+#endif /* MULTICORE_DECODER_SESSION_H_ */
+
@@ -0,0 +1,140 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#ifndef MULTICORE_STREAM_DECODER_
+#define MULTICORE_STREAM_DECODER_
+
+#include "cuhd_allocator.h"
+#include "multicore_decoder_session.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// decodes a stream that does not fit into memory with bounded memory: the
+// compressed data is pushed in decoder order, a window of units at a time
+// is synchronised by several threads and written into one of the caller's
+// output buffers, which are used in turn (a ring)
+// memory is O(window), independent of the size of the stream
+template<typename Types>
+class MulticoreBasicStreamDecoder {
+    public:
+        typedef typename Types::unit_type unit_type;
+        typedef typename Types::symbol_type symbol_type;
+        typedef MulticoreBasicDecoderSession<Types> Session;
+        typedef typename Session::Decoder Decoder;
+        typedef typename Session::Codetable Codetable;
+        typedef typename Session::InputBuffer InputBuffer;
+        typedef typename Session::OutputBuffer OutputBuffer;
+
+        // receives the symbols [position, position + size) of the stream in
+        // their original order, chunks arrive from the end of the stream to
+        // its start (the order of the decoder)
+        // the buffer is reused once the other buffers of the ring have been
+        // handed out, e.g. a writer thread may hold on to it until then
+        typedef std::function<void(const symbol_type* symbols, size_t size,
+            size_t position)> Consumer;
+
+        // decodes a stream of num_symbols symbols, whose first unit holds
+        // first_bit bits and whose decoder starts at first_state (see
+        // CUHDInputBuffer)
+        // windows of window_units units (rounded down to a multiple of
+        // subsequence_size) are synchronised by num_threads threads, each
+        // into one of buffers, which hold buffer_size symbols each
+        // windows with more symbols than that are split, a subsequence
+        // with more symbols than that is handed out in several buffers
+        MulticoreBasicStreamDecoder(
+            std::shared_ptr<Codetable> tab,
+            size_t num_symbols,
+            size_t first_bit,
+            size_t first_state,
+            std::vector<symbol_type*> buffers,
+            size_t buffer_size,
+            Consumer consumer,
+            size_t window_units,
+            size_t num_threads,
+            size_t subsequence_size = 4,
+            std::shared_ptr<CUHDAllocator> allocator = nullptr);
+
+        MulticoreBasicStreamDecoder(
+            const MulticoreBasicStreamDecoder&) = delete;
+        MulticoreBasicStreamDecoder& operator=(
+            const MulticoreBasicStreamDecoder&) = delete;
+
+        // appends count units of the stream, every full window is decoded
+        // right away
+        void push(const unit_type* units, size_t count);
+
+        // decodes the units pushed so far as the end of the stream, the
+        // consumer has received all symbols afterwards
+        void finish();
+
+        // number of symbols handed to the consumer so far
+        size_t get_num_decoded();
+
+    private:
+        typedef typename Decoder::SubsequenceSyncPoint SubsequenceSyncPoint;
+
+        // decodes the first num_units units of the input, fewer if their
+        // symbols do not fit into a buffer, and continues after them
+        void decode_window(size_t num_units);
+
+        // decodes the remaining input as the end of the stream
+        void decode_last();
+
+        // buffer to decode num_symbols symbols into: the next buffer of
+        // the ring, or the overflow buffer if they do not fit
+        symbol_type* get_output(size_t num_symbols);
+
+        // hands the num_symbols symbols decoded into get_output() over, in
+        // as many buffers as needed
+        void emit(size_t num_symbols);
+
+        // session for windows with at least as many subsequences as
+        // threads, the rest is decoded by a single thread
+        Session& get_session(size_t num_units);
+
+        std::shared_ptr<Codetable> tab_;
+
+        const size_t num_symbols_;
+        size_t num_decoded_;
+
+        // start of the units not yet decoded
+        size_t first_bit_;
+        size_t first_state_;
+
+        std::vector<symbol_type*> buffers_;
+        const size_t buffer_size_;
+        size_t next_buffer_;
+
+        Consumer consumer_;
+
+        const size_t subsequence_size_;
+        const size_t window_units_;
+
+        // a window and the units after it, which its last codewords reach
+        // into, the padding is added by finish()
+        std::shared_ptr<unit_type[]> input_;
+        size_t input_size_;
+
+        // symbols of a subsequence that do not fit into a buffer, grows to
+        // the largest such subsequence
+        std::shared_ptr<symbol_type[]> overflow_;
+        size_t overflow_size_;
+
+        std::shared_ptr<CUHDAllocator> allocator_;
+
+        std::unique_ptr<Session> session_;
+        std::unique_ptr<Session> single_session_;
+};
+
+typedef MulticoreBasicStreamDecoder<CUHDDefaultTypes> MulticoreStreamDecoder;
+
+#endif /* MULTICORE_STREAM_DECODER_H_ */
@@ -9,90 +9,230 @@
  *****************************************************************************/
 
 #include "ans_encoder.h"
+#include "cuhd_dispatch.h"
+#include "cuhd_bit_io.h"
 
-void ANSEncoder::encode_memory(UNIT_TYPE* out, size_t size_out,
-    SYMBOL_TYPE* in, size_t size_in,
-    std::shared_ptr<ANSEncoderTable> encoder_table,
-    std::shared_ptr<Decoder_Info> decoder_info) {
-    
-    UNIT_TYPE* out_ptr = out;
-    
-    const size_t max_bits = sizeof(UNIT_TYPE) * 8;
-    const size_t num_states = encoder_table->table.at(0).size();
+#include <algorithm>
+#include <cassert>
 
-    UNIT_TYPE window = 0;
-    UNIT_TYPE state = 0;
-    UNIT_TYPE final_state = 0;
-    size_t final_bit = 0;
-    size_t final_size = 0;
-    
-    size_t at = 0;
-    size_t in_unit = 0;
+namespace {
 
-    for(size_t i = 0; i < size_out && in_unit < size_in + 1; ++i) {
-        auto next_state = encoder_table->table[in[in_unit]][state];
-        state = next_state.next_state - num_states;
-        auto rem = next_state.code_sequence;
-        auto shift = next_state.code_length;
+    using cuhd::BitWriter;
+    using cuhd::put_symbol;
+    using cuhd::flush;
+    
+    // body of ANSEncoder::encode_memory
+    template<typename Types>
+    CUHD_FORCE_INLINE void encode_kernel(typename Types::unit_type* out,
+        size_t size_out,
+        typename Types::symbol_type* in, size_t size_in,
+        std::shared_ptr<ANSBasicEncoderTable<Types>> encoder_table,
+        std::shared_ptr<typename ANSBasicEncoder<Types>::Decoder_Info>
+            decoder_info,
+        size_t checkpoint_interval,
+        std::shared_ptr<std::vector<CUHDBasicSyncCheckpoint<Types>>>
+            checkpoints) {
         
-        while(at + shift < max_bits && in_unit < size_in) {
-            window <<= shift;
-            window += rem;
-            at += shift;
-            ++in_unit;
-
-            if(in_unit < size_in) {
-                next_state = encoder_table->table[in[in_unit]][state];
-                state = next_state.next_state - num_states;
-                rem = next_state.code_sequence;
-                shift = next_state.code_length;
+        const ANSBasicEncoderTable<Types>& table = *encoder_table;
+        
+        BitWriter<Types> w = {0, 0, out + size_out - 1, 0};
+        std::uint32_t x = table.number_of_states;
+        size_t i = 0;
+        
+        if(checkpoints) {
+            for(; i < size_in; ++i) {
+                put_symbol(w, table, in[i], x);
+                
+                // a checkpoint follows the last codeword starting in front
+                // of the unit
+                if(flush(w) && w.num_units % checkpoint_interval == 0) {
+                    checkpoints->push_back({x, w.num_bits,
+                        w.num_units, i + 1});
+                }
             }
-            
-            final_state = next_state.next_state;
         }
         
-        const size_t diff = at + shift - max_bits;
-        final_bit = at;
-        final_size = i;
-
-        window <<= shift - diff;
-        window += (rem >> diff);
+        else if(BitWriter<Types>::pairs) {
+            for(; i + 4 <= size_in; i += 4) {
+                put_symbol(w, table, in[i], x);
+                put_symbol(w, table, in[i + 1], x);
+                flush(w);
+                put_symbol(w, table, in[i + 2], x);
+                put_symbol(w, table, in[i + 3], x);
+                flush(w);
+            }
+        }
+        
+        // remaining symbols, all of them for wide tables
+        for(; i < size_in; ++i) {
+            put_symbol(w, table, in[i], x);
+            flush(w);
+        }
+        
+        // the last unit holds num_bits bits at the top, the decoder skips
+        // the rest, which is zero
+        flush(w);
         
-        out_ptr[i] = window;
+        decoder_info->state = x;
+        decoder_info->bit = w.num_bits;
+        decoder_info->size = w.num_units + 1;
         
-        window = rem & ~(~0 << diff);
-        at = diff;
+        // an empty last unit would hold no codeword, the decoders then
+        // start at a full unit (a stream without bits keeps it)
+        if(w.num_bits == 0 && w.num_units > 0) {
+            decoder_info->bit = BitWriter<Types>::unit_bits;
+            decoder_info->size = w.num_units;
+        }
+    }
+
+    // kernel variants, see CUHDDispatch
+    template<typename... Args>
+    void encode_generic(Args... args) {
+        encode_kernel(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_SSE42 void encode_sse42(Args... args) {
+        encode_kernel(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_AVX2 void encode_avx2(Args... args) {
+        encode_kernel(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_AVX512 void encode_avx512(Args... args) {
+        encode_kernel(args...);
+    }
+}
+
+template<typename Types>
+void ANSBasicEncoder<Types>::encode_memory(unit_type* out, size_t size_out,
+    symbol_type* in, size_t size_in,
+    std::shared_ptr<EncoderTable> encoder_table,
+    std::shared_ptr<Decoder_Info> decoder_info,
+    size_t checkpoint_interval,
+    std::shared_ptr<std::vector<SyncCheckpoint>> checkpoints) {
+    
+    auto kernel = encode_generic<unit_type*, size_t, symbol_type*, size_t,
+        std::shared_ptr<EncoderTable>, std::shared_ptr<Decoder_Info>,
+        size_t, std::shared_ptr<std::vector<SyncCheckpoint>>>;
+    
+    switch(CUHDDispatch::get_instruction_set()) {
+        case CUHDInstructionSet::SSE42: kernel = encode_sse42; break;
+        case CUHDInstructionSet::AVX2: kernel = encode_avx2; break;
+        case CUHDInstructionSet::AVX512: kernel = encode_avx512; break;
+        default: break;
+    }
+    
+    kernel(out, size_out, in, size_in, encoder_table, decoder_info,
+        checkpoint_interval, checkpoints);
+}
 
-        ++in_unit;
+template<typename Types>
+std::shared_ptr<typename ANSBasicEncoder<Types>::SyncIndex>
+    ANSBasicEncoder<Types>::get_sync_index(
+    std::shared_ptr<std::vector<SyncCheckpoint>> checkpoints,
+    std::shared_ptr<Decoder_Info> decoder_info,
+    size_t size_in,
+    size_t checkpoint_interval) {
+    
+    const size_t max_bits = sizeof(unit_type) * 8;
+    const size_t size_bits = decoder_info->size * max_bits;
+    
+    std::vector<SyncCheckpoint> index;
+    index.reserve(checkpoints->size() + 1);
+    
+    // start of the stream
+    size_t start = max_bits - decoder_info->bit;
+    index.push_back({decoder_info->state, (std::uint32_t) (start % max_bits),
+        start / max_bits, 0});
+    
+    // the decoder reads the bitstream backwards, a codeword ending at
+    // bit position p in encoder order starts at size_bits - p
+    for(auto it = checkpoints->rbegin(); it != checkpoints->rend(); ++it) {
+        const size_t pos = size_bits - (it->unit * max_bits + it->bit);
+        
+        index.push_back({it->state, (std::uint32_t) (pos % max_bits),
+            pos / max_bits, size_in - it->output_offset});
     }
     
-    decoder_info->state = final_state;
-    decoder_info->bit = final_bit;
-    decoder_info->size = final_size + 1;
+    return std::make_shared<SyncIndex>(index, checkpoint_interval,
+        size_in);
+}
+
+template<typename Types>
+std::shared_ptr<typename ANSBasicEncoder<Types>::InputBuffer>
+    ANSBasicEncoder<Types>::encode(
+    symbol_type* in, size_t size_in,
+    std::shared_ptr<EncoderTable> encoder_table) {
+    
+    return encode(in, size_in, encoder_table, 0);
+}
+
+template<typename Types>
+std::shared_ptr<typename ANSBasicEncoder<Types>::InputBuffer>
+    ANSBasicEncoder<Types>::encode(
+    symbol_type* in, size_t size_in,
+    std::shared_ptr<EncoderTable> encoder_table,
+    size_t checkpoint_interval) {
+    
+    // the buffer is not initialised, every unit in use is written once
+    const size_t buffer_size = get_buffer_size(encoder_table, size_in);
+    std::shared_ptr<unit_type[]> buffer
+        = CUHDAllocator::allocate_array<unit_type>(buffer_size);
+    
+    return encode_into(in, size_in, encoder_table, checkpoint_interval,
+        buffer, buffer_size);
+}
+
+template<typename Types>
+size_t ANSBasicEncoder<Types>::get_buffer_size(
+    std::shared_ptr<EncoderTable> encoder_table, size_t size_in) {
+    
+    return ANSBasicTableGenerator<Types>::get_max_compressed_size(
+        encoder_table, size_in) + INPUT_BUFFER_PADDING;
 }
 
-std::shared_ptr<CUHDInputBuffer> ANSEncoder::encode(
-    SYMBOL_TYPE* in, size_t size_in,
-    std::shared_ptr<ANSEncoderTable> encoder_table) {
+template<typename Types>
+std::shared_ptr<typename ANSBasicEncoder<Types>::InputBuffer>
+    ANSBasicEncoder<Types>::encode_into(
+    symbol_type* in, size_t size_in,
+    std::shared_ptr<EncoderTable> encoder_table,
+    size_t checkpoint_interval,
+    std::shared_ptr<unit_type[]> buffer,
+    size_t buffer_size) {
+    
+    assert(buffer_size >= get_buffer_size(encoder_table, size_in));
     
-    // maximum compressed size in units
-    size_t max_size = ANSTableGenerator::get_max_compressed_size(
-        encoder_table, size_in);
+    // units available for compressed data, followed by the padding
+    const size_t max_size = buffer_size - INPUT_BUFFER_PADDING;
     
-    // temporary buffer for compressed data
-    std::unique_ptr<UNIT_TYPE[]> compressed
-        = std::make_unique<UNIT_TYPE[]>(max_size);
-    std::memset(compressed.get(), 0, max_size * sizeof(UNIT_TYPE));
+    unit_type* padding = buffer.get() + max_size;
+    std::fill(padding, padding + INPUT_BUFFER_PADDING, 0);
     
     std::shared_ptr<Decoder_Info> decoder_info(new Decoder_Info());
     
-    encode_memory(compressed.get(), max_size,
-        in, size_in, encoder_table, decoder_info);
+    std::shared_ptr<std::vector<SyncCheckpoint>> checkpoints;
+    if(checkpoint_interval > 0)
+        checkpoints = std::make_shared<std::vector<SyncCheckpoint>>();
     
-    std::shared_ptr<CUHDInputBuffer> buffer(
-        new CUHDInputBuffer(compressed.get(), decoder_info->size,
-            decoder_info->bit, decoder_info->state));
+    encode_memory(buffer.get(), max_size,
+        in, size_in, encoder_table, decoder_info,
+        checkpoint_interval, checkpoints);
+    
+    // the compressed data ends right in front of the padding
+    std::shared_ptr<InputBuffer> input_buffer(
+        new InputBuffer(buffer, max_size - decoder_info->size,
+            decoder_info->size, decoder_info->bit, decoder_info->state));
+    
+    if(checkpoints) {
+        input_buffer->set_sync_index(get_sync_index(checkpoints,
+            decoder_info, size_in, checkpoint_interval));
+    }
     
-    return buffer;
+    return input_buffer;
 }
 
+CUHD_INSTANTIATE(ANSBasicEncoder)
@@ -0,0 +1,121 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "ans_interleaved_encoder.h"
+#include "ans_table_generator.h"
+#include "cuhd_bit_io.h"
+
+#include <algorithm>
+#include <cassert>
+
+template<typename Types>
+std::shared_ptr<typename ANSBasicInterleavedEncoder<Types>::
+    InterleavedInputBuffer> ANSBasicInterleavedEncoder<Types>::encode(
+    symbol_type* in, size_t size_in,
+    std::shared_ptr<EncoderTable> encoder_table,
+    size_t num_states,
+    size_t checkpoint_interval) {
+    
+    assert(num_states == 2 || num_states == 4 || num_states == 8);
+    assert(size_in > 0 && checkpoint_interval > 0);
+    
+    typedef typename Types::unit_type unit_type;
+    typedef typename InterleavedInputBuffer::Checkpoint Checkpoint;
+    typedef typename InterleavedInputBuffer::InputBuffer InputBuffer;
+    
+    const size_t max_bits = sizeof(unit_type) * 8;
+    const EncoderTable& table = *encoder_table;
+    const size_t number_of_states = table.number_of_states;
+    
+    // maximum compressed size in units, as for ANSEncoder
+    const size_t max_size = ANSBasicTableGenerator<Types>::
+        get_max_compressed_size(encoder_table, size_in);
+    
+    // units are written from the back of the buffer in decoder order,
+    // followed by the padding
+    std::shared_ptr<unit_type[]> buffer
+        = CUHDAllocator::allocate_array<unit_type>(
+            max_size + INPUT_BUFFER_PADDING);
+    std::fill(buffer.get() + max_size,
+        buffer.get() + max_size + INPUT_BUFFER_PADDING, 0);
+    
+    // all states start at the same state as in ANSEncoder
+    std::uint32_t states[MAX_INTERLEAVED_STATES];
+    std::fill(states, states + MAX_INTERLEAVED_STATES, number_of_states);
+    
+    // checkpoints in encoder order: unit, number of bits already used in
+    // the unit and number of symbols encoded so far
+    std::vector<Checkpoint> checkpoints;
+    size_t next_checkpoint = checkpoint_interval;
+    
+    cuhd::BitWriter<Types> w = {0, 0, buffer.get() + max_size - 1, 0};
+    
+    for(size_t i = 0; i < size_in; ++i) {
+        if(w.num_units >= next_checkpoint) {
+            Checkpoint checkpoint;
+            
+            for(size_t j = 0; j < MAX_INTERLEAVED_STATES; ++j)
+                checkpoint.states[j] = states[j];
+            
+            checkpoint.bit = w.num_bits;
+            checkpoint.unit = w.num_units;
+            checkpoint.output_offset = i;
+            checkpoints.push_back(checkpoint);
+            
+            next_checkpoint += checkpoint_interval;
+        }
+        
+        cuhd::put_symbol(w, table, in[i], states[i % num_states]);
+        cuhd::flush(w);
+    }
+    
+    // the last unit holds num_bits bits at the top, the decoder skips the
+    // rest, which is zero, an empty last unit is left out
+    cuhd::flush(w);
+    
+    const size_t first_bit = w.num_bits > 0 ? w.num_bits : max_bits;
+    const size_t size = w.num_units + (w.num_bits > 0);
+    
+    const size_t size_bits = size * max_bits;
+    
+    // convert checkpoints into decoder order, a codeword ending at bit
+    // position p in encoder order starts at size_bits - p
+    std::vector<Checkpoint> index;
+    index.reserve(checkpoints.size() + 1);
+    
+    Checkpoint start;
+    
+    for(size_t j = 0; j < MAX_INTERLEAVED_STATES; ++j)
+        start.states[j] = states[j];
+    
+    start.bit = (max_bits - first_bit) % max_bits;
+    start.unit = (max_bits - first_bit) / max_bits;
+    start.output_offset = 0;
+    index.push_back(start);
+    
+    for(auto it = checkpoints.rbegin(); it != checkpoints.rend(); ++it) {
+        const size_t pos = size_bits - (it->unit * max_bits + it->bit);
+        
+        Checkpoint checkpoint = *it;
+        checkpoint.bit = pos % max_bits;
+        checkpoint.unit = pos / max_bits;
+        checkpoint.output_offset = size_in - it->output_offset;
+        index.push_back(checkpoint);
+    }
+    
+    std::shared_ptr<InputBuffer> stream(
+        new InputBuffer(buffer, max_size - size, size, first_bit,
+            start.states[(size_in - 1) % num_states]));
+    
+    return std::make_shared<InterleavedInputBuffer>(stream, num_states,
+        size_in, index);
+}
+
+CUHD_INSTANTIATE(ANSBasicInterleavedEncoder)
@@ -14,9 +14,25 @@
 #include <random>
 #include <algorithm>
 #include <cassert>
+#include <thread>
 
-Distribution ANSTableGenerator::generate_distribution(
+namespace {
+
+    // position of the next state of a symbol index in the spread
+    struct Heap_Entry {double p; std::uint32_t idx;};
+    
+    // order of std::make_heap and friends, the smallest entry on top
+    inline bool heap_after(const Heap_Entry& a, const Heap_Entry& b) {
+        return a.p > b.p || (a.p == b.p && a.idx > b.idx);
+    }
+}
+
+template<typename Types>
+typename ANSBasicTableGenerator<Types>::Distribution
+    ANSBasicTableGenerator<Types>::generate_distribution(
     size_t seed, size_t n, size_t N, std::function<double(double)> fun) {
+    assert(n <= N);
+    
     std::mt19937 engine(seed);
     std::uniform_real_distribution<double> dist(0.0, 1.0);
     
@@ -58,45 +74,58 @@ Distribution ANSTableGenerator::generate_distribution(
             std::make_shared<std::vector<size_t>>(distr)};
 }
 
-Distribution ANSTableGenerator::generate_distribution_from_buffer(
-    size_t seed, size_t N, std::uint8_t* in, size_t size) {
+template<typename Types>
+typename ANSBasicTableGenerator<Types>::Distribution
+    ANSBasicTableGenerator<Types>::generate_distribution_from_buffer(
+    size_t seed, size_t N, symbol_type* in, size_t size) {
     
-    const size_t max_num_symbols = 1 << (sizeof(SYMBOL_TYPE) * 8);
+    const size_t max_num_symbols = 1 << (sizeof(symbol_type) * 8);
     
-    std::uint32_t frequencies[max_num_symbols];
-    
-    for(size_t i = 0; i < max_num_symbols; ++i)
-        frequencies[i] = 0;
+    std::vector<std::uint32_t> frequencies(max_num_symbols, 0);
     
     for(size_t i = 0; i < size; ++i)
         ++frequencies[in[i]];
     
-    std::vector<size_t> freq_compact;
-    std::vector<SYMBOL_TYPE> symbols_compact;
+    std::vector<symbol_type> symbols_compact;
     
     for(size_t i = 0; i < max_num_symbols; ++i) {
-        if(frequencies[i] != 0) {
-            freq_compact.push_back(frequencies[i]);
-            symbols_compact.push_back(i);
-        }
+        if(frequencies[i] != 0) symbols_compact.push_back(i);
     }
     
-    std::sort(freq_compact.begin(), freq_compact.end(),
-        [](size_t a, size_t b) {return a > b;});
+    // most frequent symbols first, the frequencies stay with their symbols
+    std::stable_sort(symbols_compact.begin(), symbols_compact.end(),
+        [&](symbol_type a, symbol_type b) {
+            return frequencies[a] > frequencies[b];});
+    
+    // a single symbol would own all states and decode from 0-bit codewords
+    // only, which never advance the decoders, an unused symbol takes one
+    // state from it
+    if(symbols_compact.size() == 1)
+        symbols_compact.push_back(symbols_compact[0] == 0 ? 1 : 0);
+    
+    std::vector<size_t> freq_compact;
+    
+    for(symbol_type symbol : symbols_compact)
+        freq_compact.push_back(frequencies[symbol]);
     
     const size_t num_symbols = freq_compact.size();
+    assert(num_symbols <= N);
+    
     std::vector<double> prob_ans(num_symbols);
     std::vector<double> prob_a(num_symbols);
     
-    // normalisation process
-    double sum_a = std::accumulate(freq_compact.begin(), freq_compact.end(), 0.0f);
+    // normalisation process, every symbol gets about one state at least,
+    // for large alphabets a fixed minimum would flatten the distribution
+    const double min_prob = 1.0 / N;
+    
+    double sum_a = std::accumulate(freq_compact.begin(), freq_compact.end(), 0.0);
     std::transform(freq_compact.begin(), freq_compact.end(), prob_a.begin(), 
         [&](double x) {return x / sum_a;});
     
     std::transform(prob_a.begin(), prob_a.end(), prob_a.begin(), 
-        [&](double x) {if(x < 0.001) return x += 0.001; else return x;});
+        [&](double x) {if(x < min_prob) return x += min_prob; else return x;});
     
-    sum_a = std::accumulate(prob_a.begin(), prob_a.end(), 0.0f);
+    sum_a = std::accumulate(prob_a.begin(), prob_a.end(), 0.0);
     std::transform(prob_a.begin(), prob_a.end(), prob_ans.begin(), 
         [&](double x) {return x / sum_a;});
     
@@ -127,18 +156,19 @@ Distribution ANSTableGenerator::generate_distribution_from_buffer(
         
     return {std::make_shared<std::vector<double>>(prob_ans),
         std::make_shared<std::vector<size_t>>(freq_compact),
-        std::make_shared<std::vector<SYMBOL_TYPE>>(symbols_compact)};
+        std::make_shared<std::vector<symbol_type>>(symbols_compact)};
 }
 
-std::shared_ptr<std::vector<SYMBOL_TYPE>>
-    ANSTableGenerator::generate_test_data(
+template<typename Types>
+std::shared_ptr<std::vector<typename ANSBasicTableGenerator<Types>::symbol_type>>
+    ANSBasicTableGenerator<Types>::generate_test_data(
     std::shared_ptr<std::vector<size_t>> distr,
     size_t size,
     size_t num_states,
     size_t seed) {
     
-    std::vector<SYMBOL_TYPE> buffer(size + 8);
-    SYMBOL_TYPE symbols[num_states];
+    std::vector<symbol_type> buffer(size + 8);
+    std::vector<symbol_type> symbols(num_states);
     const size_t dist_len = distr->size();
     
     size_t index = 0;
@@ -158,44 +188,102 @@ std::shared_ptr<std::vector<SYMBOL_TYPE>>
         dist(engine);
     }
     
-    return std::make_shared<std::vector<SYMBOL_TYPE>> (buffer);
+    return std::make_shared<std::vector<symbol_type>> (buffer);
 }
 
-std::shared_ptr<std::vector<std::vector<Encoder_Table_Entry>>>
-    ANSTableGenerator::generate_table(std::shared_ptr<std::vector<double>> P_s,
+template<typename Types>
+std::shared_ptr<typename ANSBasicTableGenerator<Types>::Symbol_Spread>
+    ANSBasicTableGenerator<Types>::generate_table(
+        std::shared_ptr<std::vector<double>> P_s,
         std::shared_ptr<std::vector<size_t>> L_s,
-        std::shared_ptr<std::vector<SYMBOL_TYPE>> symbols,
+        std::shared_ptr<std::vector<symbol_type>> symbols,
         size_t num_symbols, size_t num_states) {
     
-    std::unordered_map<std::uint32_t, XS_pair> pretab;
+    assert(num_symbols <= num_states && num_states <= Types::max_num_states);
+    
+    std::shared_ptr<Symbol_Spread> table = std::make_shared<Symbol_Spread>();
+    table->num_states = num_states;
+    table->num_symbols = num_symbols;
+    table->spread.resize(num_states);
+    
+    // next sub-state, increment of the position and symbol of each index
+    std::vector<std::uint32_t> X_s(num_symbols);
+    std::vector<double> step(num_symbols);
+    std::vector<symbol_type> symbol(num_symbols);
+    
+    // min-heap of the next position of each index, ties go to the lower
+    // index like in generate_table_linear, so the spreads are identical
+    std::vector<Heap_Entry> heap(num_symbols);
+    
+    for(size_t i = 0; i < num_symbols; ++i) {
+        const double p = (*P_s)[i];
+        
+        X_s[i] = (*L_s)[i];
+        step[i] = 1 / p;
+        symbol[i] = symbols == nullptr ? (symbol_type) i : (*symbols)[i];
+        heap[i] = {0.5f / p, (std::uint32_t) i};
+    }
+    
+    if(symbols != nullptr && num_symbols > 0) {
+        table->num_symbols = *std::max_element(symbol.begin(), symbol.end())
+            + (size_t) 1;
+    }
+    
+    std::make_heap(heap.begin(), heap.end(), heap_after);
+    
+    XS_pair* spread = table->spread.data();
+    
+    for(size_t i = 0; i < num_states; ++i) {
+        std::pop_heap(heap.begin(), heap.end(), heap_after);
+        
+        Heap_Entry& q = heap.back();
+        const std::uint32_t idx = q.idx;
+        
+        spread[i] = {symbol[idx], X_s[idx]};
+        ++X_s[idx];
+        
+        q.p += step[idx];
+        std::push_heap(heap.begin(), heap.end(), heap_after);
+    }
+    
+    return table;
+}
+
+template<typename Types>
+std::shared_ptr<typename ANSBasicTableGenerator<Types>::Symbol_Spread>
+    ANSBasicTableGenerator<Types>::generate_table_linear(std::shared_ptr<std::vector<double>> P_s,
+        std::shared_ptr<std::vector<size_t>> L_s,
+        std::shared_ptr<std::vector<symbol_type>> symbols,
+        size_t num_symbols, size_t num_states) {
+    
+    assert(num_symbols <= num_states && num_states <= Types::max_num_states);
+    
     std::unordered_map<std::uint32_t, std::uint32_t> X_s;
     std::vector<Queue_Entry> queue(num_symbols);
     
-    // n x N table
-    const size_t table_size = (1 << (sizeof(SYMBOL_TYPE) * 8));
-    std::vector<std::vector<Encoder_Table_Entry>> table;
+    // one entry per state, the encoder and decoder tables are derived from
+    // it in O(num_states + num_symbols)
+    std::shared_ptr<Symbol_Spread> table = std::make_shared<Symbol_Spread>();
+    table->num_states = num_states;
+    table->num_symbols = num_symbols;
+    table->spread.resize(num_states);
     
     if(symbols == nullptr) {
-        table.resize(num_symbols);
-    
-        for(size_t i = 0; i < num_symbols; ++i)
-            table[i].resize(num_states);
-    
         for(size_t i = 0; i < num_symbols; ++i) {
-            queue[i] = {0.5f / P_s->at(i), (SYMBOL_TYPE) i};
+            queue[i] = {0.5f / P_s->at(i), (symbol_type) i};
             X_s[i] = L_s->at(i);
         }
     }
     
     else {
-        table.resize(table_size);
-    
-        for(size_t i = 0; i < table_size; ++i)
-            table[i].resize(num_states);
-    
+        table->num_symbols = 0;
+        
         for(size_t i = 0; i < num_symbols; ++i) {
             queue[i] = {0.5f / P_s->at(i), symbols->at(i)};
             X_s[i] = L_s->at(i);
+            
+            table->num_symbols = std::max<size_t>(table->num_symbols,
+                symbols->at(i) + 1);
         }
     }
     
@@ -206,10 +294,10 @@ std::shared_ptr<std::vector<std::vector<Encoder_Table_Entry>>>
             
             double v = q.p;
             size_t idx = q.s;
-            SYMBOL_TYPE s = queue[idx].s;
+            symbol_type s = queue[idx].s;
             
             queue[idx].p = v + (1 / P_s->at(s));
-            pretab[i] = {s, X_s[s]};
+            table->spread[i - num_states] = {s, X_s[s]};
             
             X_s[s] = X_s[s] + 1;
         }
@@ -217,118 +305,175 @@ std::shared_ptr<std::vector<std::vector<Encoder_Table_Entry>>>
     
     else {
         for(size_t i = num_states; i < 2 * num_states; ++i) {
-            std::vector<Queue_Entry>::iterator q_it =
+            typename std::vector<Queue_Entry>::iterator q_it =
                 std::min_element(std::begin(queue), std::end(queue),
                 [](Queue_Entry a, Queue_Entry b) {return a.p < b.p;});
             
             size_t idx = std::distance(queue.begin(), q_it);
             
             double v = queue[idx].p;
-            SYMBOL_TYPE s = queue[idx].s;
+            symbol_type s = queue[idx].s;
             
             queue[idx].p = v + (1 / P_s->at(idx));
-            pretab[i] = {s, X_s[idx]};
+            table->spread[i - num_states] = {s, X_s[idx]};
             
             X_s[idx] = X_s[idx] + 1;
         }
     }
     
-    for(std::uint32_t i = num_states; i < 2 * num_states; ++i) {
-        XS_pair tab = pretab[i];
-        SYMBOL_TYPE symbol = tab.s;
-        std::uint32_t slide = tab.next_state;
-        std::uint32_t shift = 0;
-        
-        for(; slide < 2 * num_states; slide = slide * 2) {
-            for(std::uint32_t rem = 0; rem < (unsigned) (1 << shift); ++rem) {
-                if(num_states <= (slide + rem)
-                    && (slide + rem) < 2 * num_states) {
-                    
-                    size_t idx2 = slide + rem - num_states;
-                    
-                    table.at(symbol).at(idx2) = {i, rem, shift, symbol};
-                }
-            }
-            
-            ++shift;
-        }
-    }
+    return table;
+}
+
+template<typename Types>
+bool ANSBasicTableGenerator<Types>::equals(std::shared_ptr<Symbol_Spread> a,
+    std::shared_ptr<Symbol_Spread> b) {
+    
+    if(a->num_states != b->num_states || a->num_symbols != b->num_symbols
+        || a->spread.size() != b->spread.size()) return false;
     
-    return std::make_shared<std::vector<std::vector<Encoder_Table_Entry>>>
-        (table);
+    return std::equal(a->spread.begin(), a->spread.end(), b->spread.begin(),
+        [](const XS_pair& x, const XS_pair& y) {
+            return x.s == y.s && x.next_state == y.next_state;});
 }
 
-std::shared_ptr<CUHDCodetable> ANSTableGenerator::get_decoder_table(
-    std::shared_ptr<ANSEncoderTable> enc_table) {
+template<typename Types>
+std::shared_ptr<typename ANSBasicTableGenerator<Types>::Codetable>
+    ANSBasicTableGenerator<Types>::get_decoder_table(
+    std::shared_ptr<EncoderTable> enc_table, size_t num_threads) {
     
     const size_t number_of_states = enc_table->number_of_states;
     const size_t number_of_symbols = enc_table->number_of_symbols;
     
-    CUHDCodetable table(number_of_states);
-    CUHDCodetableItem* tab = table.get();
+    Codetable table(number_of_states);
+    typename Codetable::Item* tab = table.get();
     
-    for(size_t i = 0; i < number_of_symbols; ++i) {
-        for(size_t j = 0; j < number_of_states; ++j) {
-            CUHDCodetableItem item;
-            
-            std::uint32_t prev = enc_table->table.at(i).at(j).next_state
-                - number_of_states;
-            std::uint32_t len = enc_table->table.at(i).at(j).code_length;
-            item.next_state = (number_of_states + j) >> len;
-            item.symbol = enc_table->table.at(i).at(j).symbol;
-            
-            item.min_num_bits = tab[prev].min_num_bits == 0 && len > 0 ?
-                len : tab[prev].min_num_bits;
+    // state x of symbol i is reached from the sub-state x >> len, every
+    // sub-state y in [L_s, 2 * L_s) belongs to exactly one len
+    auto fill = [&](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; ++i) {
+            const typename EncoderTable::ANSSymbolTransform& t
+                = enc_table->transform[i];
             
-            tab[prev] = item;
+            for(std::uint32_t y = t.num_states; y < 2 * t.num_states; ++y) {
+                const std::uint32_t x = enc_table->next_state[
+                    (std::uint32_t) t.delta_find_state + y];
+                
+                std::uint32_t len = 0;
+                while((y << len) < number_of_states) ++len;
+                
+                typename Codetable::Item item;
+                item.next_state = y;
+                item.symbol = i;
+                item.min_num_bits = len;
+                
+                tab[x - number_of_states] = item;
+            }
         }
+    };
+    
+    num_threads = std::max((size_t) 1, std::min(num_threads,
+        number_of_symbols));
+    
+    if(num_threads == 1) {
+        fill(0, number_of_symbols);
+        return std::make_shared<Codetable> (table);
     }
+    
+    // the symbols own disjoint states, so each thread takes a range of
+    // symbols with about number_of_states / num_threads states
+    std::vector<std::thread> threads;
+    size_t begin = 0;
+    size_t num_states = 0;
+    
+    for(size_t i = 0; i < number_of_symbols; ++i) {
+        num_states += enc_table->transform[i].num_states;
+        
+        if(num_states * num_threads
+            >= (threads.size() + 1) * number_of_states
+            && threads.size() + 1 < num_threads) {
+            threads.emplace_back(fill, begin, i + 1);
+            begin = i + 1;
+        }
+    }
+    
+    fill(begin, number_of_symbols);
+    
+    for(auto& t : threads) t.join();
 
-    return std::make_shared<CUHDCodetable> (table);
+    return std::make_shared<Codetable> (table);
 }
 
-std::shared_ptr<ANSEncoderTable> ANSTableGenerator::generate_encoder_table(
-    std::shared_ptr<std::vector<std::vector<Encoder_Table_Entry>>> tab) {
+template<typename Types>
+std::shared_ptr<typename ANSBasicTableGenerator<Types>::EncoderTable>
+    ANSBasicTableGenerator<Types>::generate_encoder_table(
+    std::shared_ptr<Symbol_Spread> tab) {
     
-    ANSEncoderTable enc_table;
-    const size_t number_of_symbols = tab->size();
-    enc_table.number_of_states = tab->at(0).size();
+    EncoderTable enc_table;
+    const size_t number_of_symbols = tab->num_symbols;
+    const size_t number_of_states = tab->num_states;
     
-    enc_table.max_number_of_symbols = 1 << (sizeof(SYMBOL_TYPE) * 8);
+    enc_table.number_of_states = number_of_states;
+    enc_table.max_number_of_symbols = 1 << (sizeof(symbol_type) * 8);
     enc_table.number_of_symbols = number_of_symbols;
     
-    enc_table.table.resize(number_of_symbols);
+    // the next states of each symbol are indexed by the state shifted by
+    // the codeword length
+    enc_table.transform.resize(number_of_symbols, {0, 0, 0});
+    enc_table.next_state.resize(number_of_states, 0);
     
-    for(size_t i = 0; i < enc_table.number_of_symbols; ++i) {
-        enc_table.table.at(i).resize(enc_table.number_of_states);
+    for(const XS_pair& entry : tab->spread)
+        ++enc_table.transform[entry.s].num_states;
     
-        for(size_t j = 0; j < enc_table.number_of_states; ++j) {
-            Encoder_Table_Entry entry = tab->at(i).at(j);
-
-            enc_table.table.at(i).at(j)
-                = {entry.x, entry.rem, entry.shift, entry.symbol};
-        }
+    size_t start = 0;
+    
+    for(size_t i = 0; i < number_of_symbols; ++i) {
+        typename EncoderTable::ANSSymbolTransform& t = enc_table.transform[i];
+        const std::uint64_t num_states = t.num_states;
+        
+        // symbol does not occur
+        if(num_states == 0) continue;
+        
+        // the longest codewords are taken by the largest states
+        std::uint64_t max_bits = 0;
+        while(((2 * number_of_states - 1) >> max_bits) >= 2 * num_states)
+            ++max_bits;
+        
+        const std::uint64_t min_state = num_states << max_bits;
+        
+        t.delta_num_bits = (max_bits << 32) - min_state;
+        t.delta_find_state = (std::int32_t) start - (std::int32_t) num_states;
+        
+        start += num_states;
     }
-
-    return std::make_shared<ANSEncoderTable>(enc_table);
+    
+    assert(start == number_of_states);
+    
+    for(size_t i = 0; i < number_of_states; ++i) {
+        const XS_pair& entry = tab->spread[i];
+        const typename EncoderTable::ANSSymbolTransform& t
+            = enc_table.transform[entry.s];
+        
+        enc_table.next_state[(std::uint32_t) t.delta_find_state
+            + entry.next_state] = number_of_states + i;
+    }
+    
+    return std::make_shared<EncoderTable>(enc_table);
 }
 
-size_t ANSTableGenerator::get_max_compressed_size(
-    std::shared_ptr<ANSEncoderTable> encoder_table, size_t input_size) {
-    
-    const size_t num_symbols = encoder_table->table.size();
-    const size_t num_states = encoder_table->table.at(0).size();
+template<typename Types>
+size_t ANSBasicTableGenerator<Types>::get_max_compressed_size(
+    std::shared_ptr<EncoderTable> encoder_table, size_t input_size) {
     
-    // find maximum codeword length
-    const size_t max = encoder_table->table.at(num_symbols - 1)
-        .at(num_states - 1).code_length;
+    const size_t max = encoder_table->get_max_code_length();
         
     size_t size = ((max * input_size) / 8) + 1;
     
 	// calculate number of units
-	size_t compressed_size_units = size % sizeof(UNIT_TYPE) == 0 ?
-		size / sizeof(UNIT_TYPE) : size / sizeof(UNIT_TYPE) + 1;
+	const size_t unit_size = sizeof(typename Types::unit_type);
+	size_t compressed_size_units = size % unit_size == 0 ?
+		size / unit_size : size / unit_size + 1;
     
     return compressed_size_units;
 }
 
+CUHD_INSTANTIATE(ANSBasicTableGenerator)
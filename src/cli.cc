@@ -0,0 +1,344 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "multians.h"
+
+// command-line tool: compresses files into containers (bytes as symbols),
+// decompresses them and measures the throughput of both
+
+// default number of states of the table
+#define NUM_STATES 4096
+
+// default number of symbols per block (4 MB)
+#define BLOCK_SIZE (4 << 20)
+
+// default number of units between two checkpoints, the decoders start at
+// the checkpoints instead of synchronising (about 0.2% larger files)
+#define CHECKPOINT_INTERVAL 4096
+
+// number of decodes of the benchmark, the fastest one is reported
+#define BENCH_RUNS 3
+
+// suffix of compressed files
+#define SUFFIX ".mans"
+
+typedef CUHDUnit32Symbol8 Types;
+typedef CUHDBasicContainer<Types> Container;
+
+struct Options {
+    size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t num_states = NUM_STATES;
+    size_t block_size = BLOCK_SIZE;
+
+    // units between two checkpoints, 0 without sync index
+    size_t checkpoint_interval = CHECKPOINT_INTERVAL;
+};
+
+namespace {
+
+    // write() may write less than asked for
+    bool write_all(int fd, const std::uint8_t* data, size_t size) {
+        while(size > 0) {
+            const ssize_t written = write(fd, data, size);
+
+            if(written < 0 && errno == EINTR) continue;
+            if(written <= 0) return false;
+
+            data += written;
+            size -= written;
+        }
+
+        return true;
+    }
+
+    size_t get_file_size(const std::string& path) {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 ? info.st_size : 0;
+    }
+
+    void print_result(const std::string& label, size_t size, size_t time) {
+        std::cout << std::left << std::setw(12) << label
+            << std::right << std::setw(10) << time << " μs "
+            << std::setw(10) << size / std::max<size_t>(time, 1) << " MB/s"
+            << std::endl;
+    }
+
+    void print_ratio(size_t size, size_t compressed_size) {
+        std::cout << size << " -> " << compressed_size << " bytes";
+
+        if(size > 0) {
+            std::cout << " (" << std::setprecision(4)
+                << 8.0 * compressed_size / size << " bits per symbol)";
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+int compress(const std::string& in_path, const std::string& out_path,
+    const Options& options) {
+
+    std::shared_ptr<CUHDMappedFile> in = CUHDMappedFile::open(in_path);
+
+    if(!in) {
+        std::cerr << "cannot read " << in_path << std::endl;
+        return 1;
+    }
+
+    const size_t size = in->get_size();
+
+    // the whole input is read once, in order
+    in->prefetch(0, size);
+
+    bool written = false;
+    std::vector<std::pair<std::string, size_t>> timings;
+
+    // the encoder only reads the mapping
+    TIMER_START(timings, "compress")
+    written = Container::write(out_path,
+        const_cast<std::uint8_t*>(in->get()), size,
+        options.num_states, options.block_size,
+        options.checkpoint_interval, options.num_threads);
+    TIMER_STOP
+
+    if(!written) {
+        std::cerr << "cannot write " << out_path << std::endl;
+        return 1;
+    }
+
+    print_ratio(size, get_file_size(out_path));
+    print_result("compress", size, timings.back().second);
+
+    return 0;
+}
+
+int decompress(const std::string& in_path, const std::string& out_path,
+    const Options& options) {
+
+    std::shared_ptr<Container> in = Container::open(in_path);
+
+    if(!in) {
+        std::cerr << in_path << " is not a valid container" << std::endl;
+        return 1;
+    }
+
+    const int fd = open(out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if(fd < 0) {
+        std::cerr << "cannot write " << out_path << std::endl;
+        return 1;
+    }
+
+    const size_t num_blocks = in->get_num_blocks();
+    const size_t block_size = num_blocks > 0 ? in->get_block_size(0) : 0;
+
+    // a batch of blocks is decoded while the previous one is written, two
+    // buffers of one batch each, which are never initialised
+    const size_t batch = options.num_threads;
+
+    std::shared_ptr<std::uint8_t[]> buffers[2] = {
+        CUHDAllocator::allocate_array<std::uint8_t>(batch * block_size),
+        CUHDAllocator::allocate_array<std::uint8_t>(batch * block_size)};
+
+    std::thread writer;
+    bool ok = true;
+
+    std::vector<std::pair<std::string, size_t>> timings;
+
+    TIMER_START(timings, "decompress")
+    for(size_t first = 0, k = 0; first < num_blocks; first += batch, ++k) {
+        const size_t count = std::min(batch, num_blocks - first);
+
+        if(first + count < num_blocks)
+            in->prefetch(first + count, std::min(batch,
+                num_blocks - first - count));
+
+        std::uint8_t* out = buffers[k % 2].get();
+        in->decode(first, count, out, options.num_threads);
+
+        if(writer.joinable()) writer.join();
+
+        const size_t size = in->get_block_begin(first + count - 1)
+            + in->get_block_size(first + count - 1)
+            - in->get_block_begin(first);
+
+        writer = std::thread([&ok, fd, out, size]() {
+            if(!write_all(fd, out, size)) ok = false;});
+    }
+
+    if(writer.joinable()) writer.join();
+    TIMER_STOP
+
+    if(close(fd) != 0) ok = false;
+
+    if(!ok) {
+        std::cerr << "cannot write " << out_path << std::endl;
+        return 1;
+    }
+
+    print_ratio(in->get_size(), get_file_size(in_path));
+    print_result("decompress", in->get_size(), timings.back().second);
+
+    return 0;
+}
+
+// compresses into out_path, decodes it BENCH_RUNS times into memory and
+// removes it again
+int bench(const std::string& in_path, const std::string& out_path,
+    const Options& options) {
+
+    if(compress(in_path, out_path, options) != 0) return 1;
+
+    std::shared_ptr<CUHDMappedFile> original = CUHDMappedFile::open(in_path);
+    std::shared_ptr<Container> in = Container::open(out_path);
+
+    unlink(out_path.c_str());
+
+    if(!original || !in) {
+        std::cerr << "cannot read " << out_path << std::endl;
+        return 1;
+    }
+
+    const size_t size = in->get_size();
+
+    if(size != original->get_size()) {
+        std::cerr << "mismatch" << std::endl;
+        return 1;
+    }
+
+    std::shared_ptr<std::uint8_t[]> out
+        = CUHDAllocator::allocate_array<std::uint8_t>(size);
+
+    std::vector<std::pair<std::string, size_t>> timings;
+
+    for(size_t i = 0; i < BENCH_RUNS; ++i) {
+
+        // fresh pages are zero, the complement of the original makes every
+        // byte the decoder leaves unwritten a mismatch
+        std::transform(original->get(), original->get() + size, out.get(),
+            [](std::uint8_t byte) {return (std::uint8_t) ~byte;});
+
+        TIMER_START(timings, "decode")
+        in->decode(out.get(), options.num_threads);
+        TIMER_STOP
+
+        if(!std::equal(out.get(), out.get() + size, original->get())) {
+            std::cerr << "mismatch" << std::endl;
+            return 1;
+        }
+    }
+
+    size_t time = timings.front().second;
+    for(auto& t : timings) time = std::min(time, t.second);
+
+    print_result("decode", size, time);
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+
+    // name of the binary file
+    const char* bin = argv[0];
+
+    auto print_help = [&]() {
+        std::cout << "USAGE: " << bin << " c|d|bench <file> [output] "
+            << "[-t <number of threads>] [-s <number of states>] "
+            << "[-b <block size in kilobytes>] "
+            << "[-i <units between checkpoints>]" << std::endl;
+    };
+
+    if(argc < 3) {print_help(); return 1;}
+
+    const std::string mode = argv[1];
+    const std::string in_path = argv[2];
+    std::string out_path;
+
+    Options options;
+
+    for(int i = 3; i < argc; ++i) {
+        const std::string arg = argv[i];
+
+        if(arg[0] != '-') {
+            out_path = arg;
+            continue;
+        }
+
+        if(i + 1 == argc || arg.size() != 2) {print_help(); return 1;}
+
+        const long int value = atol(argv[++i]);
+        if(value < 0 || (value == 0 && arg != "-i")) {
+            print_help();
+            return 1;
+        }
+
+        switch(arg[1]) {
+            case 't': options.num_threads = value; break;
+            case 's': options.num_states = value; break;
+            case 'b': options.block_size = value * 1024; break;
+            case 'i': options.checkpoint_interval = value; break;
+            default: print_help(); return 1;
+        }
+    }
+
+    // tANS tables have a power of two states, at least one per symbol
+    const size_t max_states = Types::max_num_states;
+
+    if(options.num_states < 256 || options.num_states > max_states
+        || (options.num_states & (options.num_states - 1)) != 0) {
+        std::cerr << "the number of states must be a power of two "
+            << "between 256 and " << max_states << std::endl;
+        return 1;
+    }
+
+    // large buffers are backed by huge pages
+    CUHDAllocator::set_default(std::make_shared<CUHDHugePageAllocator>());
+
+    // the compressed file gets a suffix, which decompression strips
+    const size_t suffix = std::string(SUFFIX).size();
+    const bool has_suffix = in_path.size() > suffix
+        && in_path.compare(in_path.size() - suffix, suffix, SUFFIX) == 0;
+
+    if(mode == "c") {
+        if(out_path.empty()) out_path = in_path + SUFFIX;
+        return compress(in_path, out_path, options);
+    }
+
+    if(mode == "d") {
+        if(out_path.empty()) {
+            out_path = has_suffix ?
+                in_path.substr(0, in_path.size() - suffix) : in_path + ".out";
+        }
+
+        return decompress(in_path, out_path, options);
+    }
+
+    // not the name of the compressed file, which would be overwritten
+    if(mode == "bench") {
+        if(out_path.empty()) out_path = in_path + ".bench" + SUFFIX;
+        return bench(in_path, out_path, options);
+    }
+
+    print_help();
+    return 1;
+}
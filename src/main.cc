@@ -13,6 +13,12 @@
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <iterator>
+#include <cmath>
+#include <string>
+#include <functional>
+#include <cstdio>
 
 #include "multians.h"
 
@@ -28,21 +34,116 @@
 // SUBSEQUENCE_SIZE must be a multiple of 4
 #define SUBSEQUENCE_SIZE 4
 
+// number of units between two checkpoints of the sync index
+#define CHECKPOINT_INTERVAL (1024 * SUBSEQUENCE_SIZE)
+
+// number of states of the interleaved stream (2, 4 or 8)
+#define INTERLEAVED_STATES 4
+
 // number of GPU threads per thread block //
 #define THREADS_PER_BLOCK 128
 
+// state counts of the table benchmark (2^10 to 2^22) //
+#define MIN_STATE_BITS 10
+#define MAX_STATE_BITS 22
+
+// Zipf exponent of the data of the table benchmark
+#define ZIPF_EXPONENT 1.6
+
+// alphabet of the 16-bit symbols of the table construction benchmark
+#define NUM_WIDE_SYMBOLS 4096
+
+// the linear table builder is skipped above states * symbols
+#define MAX_LINEAR_STEPS (1ull << 30)
+
+// skewed table of the decoder checks, its most frequent symbol owns about
+// 240 of the states, so the last symbols of a stream often take no bits
+#define SKEWED_NUM_SYMBOLS 5
+#define SKEWED_NUM_STATES 256
+#define SKEWED_LAMBDA 3.0
+
+// largest number of threads of the decoder checks
+#define CHECK_THREADS 4
+
+// symbol the output buffers of the decoder checks are filled with, it is
+// not part of the skewed alphabet
+#define POISON 0xEE
+
+// rate parameter of the data of the stream decoder check
+#define STREAM_LAMBDA 3.0
+
+// largest number of units pushed at once in the stream decoder check
+#define MAX_PUSH_UNITS 37
+
+// checkpoint distance (units) and number of random slices of the range
+// checks, and the symbols behind each slice that must stay untouched
+#define RANGE_CHECKPOINT_INTERVAL 16
+#define RANGE_SLICES 300
+#define RANGE_GUARD 64
+
+// container written and removed by the range check
+#define RANGE_CONTAINER "multians_range_check.tmp"
+
+// table files written and removed by the table file check
+#define PACKED_TABLE_FILE "multians_packed_check.tmp"
+#define COUNTS_TABLE_FILE "multians_counts_check.tmp"
+#define CORRUPT_TABLE_FILE "multians_corrupt_check.tmp"
+
 void run(long int input_size, long int num_threads) {
 
+    // kernel variant selected for this CPU (or by MULTIANS_ISA)
+    std::cout << "instruction set: " << CUHDDispatch::get_name(
+        CUHDDispatch::get_instruction_set()) << std::endl << std::endl;
+
     // print column headers
     std::cout << "\u03BB | compressed size (bytes) | ";
     #ifdef MULTI
     std::cout << "time [multicore] (\u03BCs) | ";
+    std::cout << "time [work stealing] (\u03BCs) | ";
+    std::cout << "time [pipelined] (\u03BCs) | ";
+    std::cout << "time [speculative] (\u03BCs) | ";
+    std::cout << "time [indexed] (\u03BCs) | ";
+    std::cout << "time [interleaved] (\u03BCs) | ";
+    std::cout << "time [forward] (\u03BCs) | ";
     #endif
     #ifdef CUDA
     std::cout << "time [gpu decode] (\u03BCs)";
     #endif
     std::cout << std::endl << std::endl;
     
+    #ifdef MULTI
+    
+    // CPU threads are created once and reused for all datasets,
+    // one session for each synchronisation strategy
+    const MulticoreSyncMode sync_modes[] = {MulticoreSyncMode::ROUNDS,
+        MulticoreSyncMode::WORK_STEALING, MulticoreSyncMode::PIPELINED};
+    
+    std::vector<std::shared_ptr<MulticoreDecoderSession>> sessions;
+    
+    for(auto mode : sync_modes) {
+        MulticoreDecoderOptions options;
+        options.sync_mode = mode;
+        
+        sessions.push_back(std::make_shared<MulticoreDecoderSession>(
+            num_threads, options));
+    }
+    
+    // round-based synchronisation with speculative writing
+    MulticoreDecoderOptions speculative;
+    speculative.speculative_write = true;
+    
+    sessions.push_back(std::make_shared<MulticoreDecoderSession>(
+        num_threads, speculative));
+    
+    // work stealing, symbols are written in their original order
+    MulticoreDecoderOptions forward;
+    forward.sync_mode = MulticoreSyncMode::WORK_STEALING;
+    forward.forward_output = true;
+    
+    auto forward_session = std::make_shared<MulticoreDecoderSession>(
+        num_threads, forward);
+    #endif
+    
     for(float lambda = 0.1f; lambda < 2.5f; lambda += 0.16) {
     
         // vectors to record timings
@@ -76,6 +177,18 @@ void run(long int input_size, long int num_threads) {
         auto input_buffer = ANSEncoder::encode(
             random_data->data(), input_size, encoder_table);
         
+        #ifdef MULTI
+        
+        // encode again, this time with a sync index
+        auto indexed_buffer = ANSEncoder::encode(random_data->data(),
+            input_size, encoder_table, CHECKPOINT_INTERVAL);
+        
+        // encode again, this time with interleaved states
+        auto interleaved_buffer = ANSInterleavedEncoder::encode(
+            random_data->data(), input_size, encoder_table,
+            INTERLEAVED_STATES, CHECKPOINT_INTERVAL);
+        #endif
+        
         // allocate a buffer for the decoded output
         auto output_buffer = std::make_shared<CUHDOutputBuffer>(input_size);
         
@@ -130,17 +243,56 @@ void run(long int input_size, long int num_threads) {
         
         #ifdef MULTI
         
-        // decode the compressed data with multiple CPU-threads
-        TIMER_START(timings_multicore, "multicore")
-        MulticoreDecoder::decode(SUBSEQUENCE_SIZE, num_threads,
-            input_buffer->get_compressed_size(),
-            output_buffer, input_buffer, decoder_table);
+        for(auto& session : sessions) {
+        
+            // decode the compressed data with multiple CPU-threads
+            TIMER_START(timings_multicore, "multicore")
+            session->decode(SUBSEQUENCE_SIZE,
+                input_buffer->get_compressed_size(),
+                output_buffer, input_buffer, decoder_table);
+            TIMER_STOP
+            
+            // reverse all bytes
+            output_buffer->reverse();
+            
+            // check for errors in decompressed data
+            if(cuhd::CUHDUtil::equals(random_data->data(),
+                output_buffer->get_decompressed_data().get(), input_size));
+            else std::cout << "mismatch" << std::endl;
+        }
+        
+        // threads start at the checkpoints, no synchronisation
+        TIMER_START(timings_multicore, "indexed")
+        sessions.at(0)->decode(SUBSEQUENCE_SIZE,
+            indexed_buffer->get_compressed_size(),
+            output_buffer, indexed_buffer, decoder_table);
+        TIMER_STOP
+        
+        output_buffer->reverse();
+        
+        if(cuhd::CUHDUtil::equals(random_data->data(),
+            output_buffer->get_decompressed_data().get(), input_size));
+        else std::cout << "mismatch" << std::endl;
+        
+        // several independent states per thread
+        TIMER_START(timings_multicore, "interleaved")
+        sessions.at(0)->decode_interleaved(
+            output_buffer, interleaved_buffer, decoder_table);
         TIMER_STOP
         
-        // reverse all bytes
         output_buffer->reverse();
         
-        // check for errors in decompressed data
+        if(cuhd::CUHDUtil::equals(random_data->data(),
+            output_buffer->get_decompressed_data().get(), input_size));
+        else std::cout << "mismatch" << std::endl;
+        
+        // no reverse() required
+        TIMER_START(timings_multicore, "forward")
+        forward_session->decode(SUBSEQUENCE_SIZE,
+            input_buffer->get_compressed_size(),
+            output_buffer, input_buffer, decoder_table);
+        TIMER_STOP
+        
         if(cuhd::CUHDUtil::equals(random_data->data(),
             output_buffer->get_decompressed_data().get(), input_size));
         else std::cout << "mismatch" << std::endl;
@@ -153,16 +305,707 @@ void run(long int input_size, long int num_threads) {
         
         // print multicore runtime
         #ifdef MULTI
-        std::cout << std::left << std::setw(10)
-            << timings_multicore.at(0).second;
+        for(auto& timing : timings_multicore) {
+            std::cout << std::left << std::setw(10) << timing.second;
+        }
         #endif
         
         // print GPU runtime
         #ifdef CUDA
         std::cout << std::left << std::setw(10)
-            <<  timings_cuda.at(0).second << std::endl;
+            <<  timings_cuda.at(0).second;
         #endif
+        
+        std::cout << std::endl;
+    }
+}
+
+#ifdef MULTI
+
+// encodes data with a table of num_states states, decodes it and returns
+// the decoding time (μs), the compressed size is written to size
+template<typename Types>
+size_t run_table(std::shared_ptr<std::vector<std::uint8_t>> data,
+    size_t num_states, long int num_threads, size_t& size) {
+    
+    typedef ANSBasicTableGenerator<Types> Generator;
+    
+    const size_t input_size = data->size();
+    
+    // normalise the counts of the data to num_states states
+    auto dist = Generator::generate_distribution_from_buffer(
+        SEED, num_states, data->data(), input_size);
+    auto table = Generator::generate_table(dist.prob, dist.dist,
+        dist.symbols, dist.dist->size(), num_states);
+    auto encoder_table = Generator::generate_encoder_table(table);
+    auto decoder_table = Generator::get_decoder_table(encoder_table);
+    
+    auto input_buffer = ANSBasicEncoder<Types>::encode(
+        data->data(), input_size, encoder_table);
+    auto output_buffer
+        = std::make_shared<CUHDBasicOutputBuffer<Types>>(input_size);
+    
+    MulticoreBasicDecoderSession<Types> session(num_threads);
+    std::vector<std::pair<std::string, size_t>> timings;
+    
+    // the first run warms up the table
+    for(size_t i = 0; i < 2; ++i) {
+        TIMER_START(timings, "decode")
+        session.decode(SUBSEQUENCE_SIZE,
+            input_buffer->get_compressed_size(),
+            output_buffer, input_buffer, decoder_table);
+        TIMER_STOP
+    }
+    
+    output_buffer->reverse();
+    
+    if(cuhd::CUHDUtil::equals(data->data(),
+        output_buffer->get_decompressed_data().get(), input_size));
+    else std::cout << "mismatch" << std::endl;
+    
+    size = input_buffer->get_compressed_size()
+        * sizeof(typename Types::unit_type);
+    
+    return timings.back().second;
+}
+
+// decoding speed and compressed size for increasing state counts, once the
+// decoder table no longer fits into L2 and L3 the speed drops
+void run_states(long int input_size, long int num_threads) {
+    
+    // Zipf distributed data, the rare symbols need many states
+    std::vector<double> weights(NUM_SYMBOLS);
+    
+    for(size_t i = 0; i < NUM_SYMBOLS; ++i)
+        weights[i] = std::pow(i + 1, -ZIPF_EXPONENT);
+    
+    std::mt19937 engine(SEED);
+    std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+    
+    auto data = std::make_shared<std::vector<std::uint8_t>>(input_size);
+    for(auto& symbol : *data) symbol = zipf(engine);
+    
+    // print column headers
+    std::cout << "states | 32-bit table (KiB) | compressed size (bytes) | ";
+    std::cout << "bits per symbol | time [16-bit table] (\u03BCs) | ";
+    std::cout << "time [32-bit table] (\u03BCs) | ";
+    std::cout << "throughput [32-bit table] (MB/s)";
+    std::cout << std::endl << std::endl;
+    
+    for(size_t bits = MIN_STATE_BITS; bits <= MAX_STATE_BITS; ++bits) {
+        const size_t num_states = 1 << bits;
+        size_t size = 0;
+        
+        // 16-bit tables up to 2^16 states only
+        size_t time_narrow = 0;
+        
+        if(num_states <= CUHDUnit32Symbol8::max_num_states) {
+            time_narrow = run_table<CUHDUnit32Symbol8>(
+                data, num_states, num_threads, size);
+        }
+        
+        const size_t time_wide = run_table<CUHDUnit32Symbol8Wide>(
+            data, num_states, num_threads, size);
+        
+        const size_t table_size
+            = num_states * sizeof(CUHDBasicCodetableItem<
+                CUHDUnit32Symbol8Wide>) / 1024;
+        
+        std::cout << std::left << std::setw(10) << num_states;
+        std::cout << std::left << std::setw(10) << table_size;
+        std::cout << std::left << std::setw(10) << size;
+        std::cout << std::left << std::setw(10) << std::setprecision(4)
+            << 8.0 * size / input_size;
+        
+        if(time_narrow > 0)
+            std::cout << std::left << std::setw(10) << time_narrow;
+        else std::cout << std::left << std::setw(10) << "-";
+        
+        std::cout << std::left << std::setw(10) << time_wide;
+        std::cout << std::left << std::setw(10)
+            << input_size / std::max<size_t>(time_wide, 1);
+        std::cout << std::endl;
+    }
+}
+
+// inputs of a single symbol (a 1-byte file, a run of equal bytes), whose
+// table gets an unused second symbol, the decoders would not advance
+// otherwise
+void check_single_symbol(long int num_threads) {
+    for(size_t size : {(size_t) 1, (size_t) 1000, (size_t) 1 << 20}) {
+        auto data = std::make_shared<std::vector<std::uint8_t>>(size, 'a');
+        
+        auto dist = ANSTableGenerator::generate_distribution_from_buffer(
+            SEED, NUM_STATES, data->data(), size);
+        auto encoder_table = ANSTableGenerator::generate_encoder_table(
+            ANSTableGenerator::generate_table(dist.prob, dist.dist,
+                dist.symbols, dist.dist->size(), NUM_STATES));
+        auto decoder_table
+            = ANSTableGenerator::get_decoder_table(encoder_table);
+        
+        // synchronised threads, and threads starting at checkpoints
+        for(size_t interval : {(size_t) 0, (size_t) SUBSEQUENCE_SIZE}) {
+            auto input_buffer = ANSEncoder::encode(data->data(), size,
+                encoder_table, interval);
+            auto output_buffer = std::make_shared<CUHDOutputBuffer>(size);
+            
+            // at least one subsequence per thread
+            const size_t num_units = input_buffer->get_compressed_size();
+            const size_t threads = std::min<size_t>(num_threads,
+                SDIV(num_units, SUBSEQUENCE_SIZE));
+            
+            MulticoreDecoderSession session(threads);
+            session.decode(SUBSEQUENCE_SIZE, num_units,
+                output_buffer, input_buffer, decoder_table);
+            
+            output_buffer->reverse();
+            
+            if(cuhd::CUHDUtil::equals(data->data(),
+                output_buffer->get_decompressed_data().get(), size));
+            else std::cout << "mismatch" << std::endl;
+        }
+    }
+}
+
+// skewed data, whose last symbols often take no bits, decoded by every
+// synchronisation strategy into output buffers filled with POISON, symbols
+// left unwritten show up as mismatches
+void check_skewed() {
+    auto dist = ANSTableGenerator::generate_distribution(
+        SEED, SKEWED_NUM_SYMBOLS, SKEWED_NUM_STATES,
+        [](double x) {return SKEWED_LAMBDA * exp(-SKEWED_LAMBDA * x);});
+    auto encoder_table = ANSTableGenerator::generate_encoder_table(
+        ANSTableGenerator::generate_table(dist.prob, dist.dist, nullptr,
+            SKEWED_NUM_SYMBOLS, SKEWED_NUM_STATES));
+    auto decoder_table = ANSTableGenerator::get_decoder_table(encoder_table);
+    
+    // rounds, work stealing, pipelined, speculative and forward output
+    std::vector<MulticoreDecoderOptions> options(6);
+    options[1].sync_mode = MulticoreSyncMode::WORK_STEALING;
+    options[2].sync_mode = MulticoreSyncMode::PIPELINED;
+    options[3].speculative_write = true;
+    options[4].sync_mode = MulticoreSyncMode::WORK_STEALING;
+    options[4].forward_output = true;
+    options[5].sync_mode = MulticoreSyncMode::PIPELINED;
+    options[5].speculative_write = true;
+    
+    // sessions[threads - 1][i] decodes with options[i]
+    std::vector<std::vector<std::shared_ptr<MulticoreDecoderSession>>>
+        sessions(CHECK_THREADS);
+    
+    for(size_t threads = 1; threads <= CHECK_THREADS; ++threads) {
+        for(auto& o : options) {
+            sessions[threads - 1].push_back(
+                std::make_shared<MulticoreDecoderSession>(threads, o));
+        }
+    }
+    
+    for(size_t size = 200; size <= 20000; size = size * 13 / 10) {
+        auto data = ANSTableGenerator::generate_test_data(
+            dist.dist, size, SKEWED_NUM_STATES, SEED + size);
+        auto input_buffer = ANSEncoder::encode(data->data(), size,
+            encoder_table);
+        auto output_buffer = std::make_shared<CUHDOutputBuffer>(size);
+        
+        const size_t num_units = input_buffer->get_compressed_size();
+        SYMBOL_TYPE* out = output_buffer->get_decompressed_data().get();
+        
+        for(size_t subsequence_size : {1, 4, 16}) {
+            for(size_t threads = 1; threads <= CHECK_THREADS; ++threads) {
+            
+                // at least one subsequence per thread
+                if(SDIV(num_units, subsequence_size) < threads) break;
+                
+                for(size_t i = 0; i < options.size(); ++i) {
+                    std::fill(out, out + size, (SYMBOL_TYPE) POISON);
+                    
+                    sessions[threads - 1][i]->decode(subsequence_size,
+                        num_units, output_buffer, input_buffer,
+                        decoder_table);
+                    
+                    if(!options[i].forward_output) output_buffer->reverse();
+                    
+                    if(cuhd::CUHDUtil::equals(data->data(), out, size));
+                    else std::cout << "mismatch" << std::endl;
+                }
+            }
+        }
+    }
+}
+
+// a stream whose first half holds only the most probable symbol, so that
+// the thread decoding it finds far more symbols than its share of the
+// output: the speculative buffer overflows once and is grown to fit
+void check_speculative_fallback() {
+    const size_t size = 400000;
+    
+    auto dist = ANSTableGenerator::generate_distribution(
+        SEED, NUM_SYMBOLS, NUM_STATES,
+        [](double x) {return SKEWED_LAMBDA * exp(-SKEWED_LAMBDA * x);});
+    auto encoder_table = ANSTableGenerator::generate_encoder_table(
+        ANSTableGenerator::generate_table(dist.prob, dist.dist, nullptr,
+            NUM_SYMBOLS, NUM_STATES));
+    auto decoder_table = ANSTableGenerator::get_decoder_table(encoder_table);
+    
+    auto data = ANSTableGenerator::generate_test_data(
+        dist.dist, size, NUM_STATES, SEED);
+    std::fill(data->begin(), data->begin() + size / 2, 0);
+    
+    auto input_buffer = ANSEncoder::encode(data->data(), size,
+        encoder_table);
+    auto output_buffer = std::make_shared<CUHDOutputBuffer>(size);
+    SYMBOL_TYPE* out = output_buffer->get_decompressed_data().get();
+    
+    for(auto mode : {MulticoreSyncMode::ROUNDS,
+        MulticoreSyncMode::PIPELINED}) {
+        
+        MulticoreDecoderOptions options;
+        options.sync_mode = mode;
+        options.speculative_write = true;
+        
+        MulticoreDecoderSession session(2, options);
+        
+        // only the first decode falls back
+        for(size_t fallbacks : {1, 1}) {
+            std::fill(out, out + size, (SYMBOL_TYPE) POISON);
+            
+            session.decode(SUBSEQUENCE_SIZE,
+                input_buffer->get_compressed_size(), output_buffer,
+                input_buffer, decoder_table);
+            output_buffer->reverse();
+            
+            if(cuhd::CUHDUtil::equals(data->data(), out, size)
+                && session.get_num_speculative_fallbacks() == fallbacks);
+            else std::cout << "mismatch" << std::endl;
+        }
+    }
+}
+
+// pushes a stream of the first size symbols of data in random chunks
+// through MulticoreStreamDecoder and returns whether the symbols arrive
+// complete and in order
+bool stream_round_trip(std::shared_ptr<std::vector<SYMBOL_TYPE>> data,
+    size_t size, std::shared_ptr<CUHDInputBuffer> input_buffer,
+    std::shared_ptr<CUHDCodetable> decoder_table,
+    size_t window_units, size_t buffer_size, size_t num_threads) {
+    
+    const UNIT_TYPE* units = input_buffer->get_compressed_data();
+    const size_t num_units = input_buffer->get_compressed_size();
+    
+    std::vector<SYMBOL_TYPE> out(size, (SYMBOL_TYPE) POISON);
+    
+    // a ring of two buffers
+    std::vector<SYMBOL_TYPE> ring(2 * buffer_size);
+    std::vector<SYMBOL_TYPE*> buffers
+        = {ring.data(), ring.data() + buffer_size};
+    
+    // chunks arrive from the end of the stream to its start
+    size_t expected = size;
+    bool ordered = true;
+    
+    MulticoreStreamDecoder decoder(decoder_table, size,
+        input_buffer->get_first_bit(), input_buffer->get_first_state(),
+        buffers, buffer_size,
+        [&](const SYMBOL_TYPE* symbols, size_t num, size_t position) {
+            if(num > buffer_size || position + num != expected)
+                ordered = false;
+            else std::copy(symbols, symbols + num, out.begin() + position);
+            expected = position;
+        }, window_units, num_threads, SUBSEQUENCE_SIZE);
+    
+    std::mt19937 engine(SEED + window_units + buffer_size);
+    std::uniform_int_distribution<size_t> chunk(1, MAX_PUSH_UNITS);
+    
+    for(size_t at = 0; at < num_units;) {
+        const size_t count = std::min(chunk(engine), num_units - at);
+        decoder.push(units + at, count);
+        at += count;
     }
+    
+    decoder.finish();
+    
+    return ordered && expected == 0 && decoder.get_num_decoded() == size
+        && cuhd::CUHDUtil::equals(data->data(), out.data(), size);
+}
+
+// streams decoded by MulticoreStreamDecoder for several window, buffer and
+// thread counts, buffers of a single symbol are smaller than any
+// subsequence
+void check_stream() {
+    auto dist = ANSTableGenerator::generate_distribution(
+        SEED, NUM_SYMBOLS, NUM_STATES,
+        [](double x) {return STREAM_LAMBDA * exp(-STREAM_LAMBDA * x);});
+    auto encoder_table = ANSTableGenerator::generate_encoder_table(
+        ANSTableGenerator::generate_table(dist.prob, dist.dist, nullptr,
+            NUM_SYMBOLS, NUM_STATES));
+    auto decoder_table = ANSTableGenerator::get_decoder_table(encoder_table);
+    
+    // streams of different sizes end with different numbers of 0-bit
+    // codewords
+    for(size_t size = 1000; size <= 100000; size = size * 3 / 2) {
+        auto data = ANSTableGenerator::generate_test_data(
+            dist.dist, size, NUM_STATES, SEED + size);
+        auto input_buffer = ANSEncoder::encode(data->data(), size,
+            encoder_table);
+        
+        for(size_t window_units : {4, 16, 64, 1000}) {
+            for(size_t buffer_size : {1, 50, 4096}) {
+                for(size_t threads : {1, 3}) {
+                    if(stream_round_trip(data, size, input_buffer,
+                        decoder_table, window_units, buffer_size, threads));
+                    else std::cout << "mismatch" << std::endl;
+                }
+            }
+        }
+    }
+}
+// decodes [begin, begin + count) of data with decode_range(begin, count,
+// out) and returns whether the symbols match and the RANGE_GUARD symbols
+// behind them are still poisoned
+bool range_matches(std::shared_ptr<std::vector<SYMBOL_TYPE>> data,
+    size_t begin, size_t count,
+    std::function<void(size_t, size_t, SYMBOL_TYPE*)> decode_range) {
+    
+    std::vector<SYMBOL_TYPE> out(count + RANGE_GUARD, (SYMBOL_TYPE) POISON);
+    decode_range(begin, count, out.data());
+    
+    return std::equal(data->begin() + begin, data->begin() + begin + count,
+        out.begin()) && std::all_of(out.begin() + count, out.end(),
+        [](SYMBOL_TYPE s) {return s == (SYMBOL_TYPE) POISON;});
+}
+
+// slices of a stream of size symbols: empty and single symbols and both
+// ends, slices starting around each of the given boundaries (checkpoints
+// or blocks) and spanning up to three of them, and random slices
+std::vector<std::pair<size_t, size_t>> get_range_slices(size_t size,
+    const std::vector<size_t>& boundaries, size_t seed) {
+    
+    std::mt19937 engine(seed);
+    auto random = [&](size_t max) {
+        return std::uniform_int_distribution<size_t>(0, max)(engine);};
+    
+    std::vector<std::pair<size_t, size_t>> slices = {{0, 0}, {0, 1},
+        {size - 1, 1}, {size, 0}, {0, size}};
+    
+    const size_t span = 3 * size / (boundaries.size() + 1) + 1;
+    
+    for(size_t i = 0; i < 4; ++i) {
+        const size_t count = random(std::min(span, size));
+        slices.push_back({0, count});
+        slices.push_back({size - count, count});
+    }
+    
+    for(size_t b : boundaries) {
+        for(size_t begin : {b - std::min(b, (size_t) 1), b}) {
+            slices.push_back({begin, std::min((size_t) 2, size - begin)});
+            slices.push_back({begin, random(std::min(span, size - begin))});
+        }
+    }
+    
+    for(size_t i = 0; i < RANGE_SLICES; ++i) {
+        const size_t begin = random(size);
+        slices.push_back({begin, random(std::min(span, size - begin))});
+    }
+    
+    return slices;
+}
+
+// slices decoded by MulticoreDecoder::decode_range from the checkpoints of
+// a sync index and by CUHDContainer::decode_range across blocks, with and
+// without sync indices, for a flat and a skewed distribution
+void check_ranges() {
+    const size_t size = 50000;
+    
+    for(double lambda : {STREAM_LAMBDA / 30, STREAM_LAMBDA}) {
+        auto dist = ANSTableGenerator::generate_distribution(
+            SEED, NUM_SYMBOLS, NUM_STATES,
+            [&](double x) {return lambda * exp(-lambda * x);});
+        auto encoder_table = ANSTableGenerator::generate_encoder_table(
+            ANSTableGenerator::generate_table(dist.prob, dist.dist, nullptr,
+                NUM_SYMBOLS, NUM_STATES));
+        auto decoder_table
+            = ANSTableGenerator::get_decoder_table(encoder_table);
+        auto data = ANSTableGenerator::generate_test_data(
+            dist.dist, size, NUM_STATES, SEED);
+        
+        auto input_buffer = ANSEncoder::encode(data->data(), size,
+            encoder_table, RANGE_CHECKPOINT_INTERVAL);
+        auto index = input_buffer->get_sync_index();
+        
+        // checkpoints count the symbols from the end of the stream
+        std::vector<size_t> checkpoints;
+        
+        for(size_t i = 0; i < index->get_num_checkpoints(); ++i)
+            checkpoints.push_back(size - index->get()[i].output_offset);
+        
+        for(auto& slice : get_range_slices(size, checkpoints, SEED)) {
+            if(range_matches(data, slice.first, slice.second,
+                [&](size_t begin, size_t count, SYMBOL_TYPE* out) {
+                    MulticoreDecoder::decode_range(input_buffer,
+                        decoder_table, begin, count, out);}));
+            else std::cout << "mismatch" << std::endl;
+        }
+        
+        for(size_t interval : {0, RANGE_CHECKPOINT_INTERVAL}) {
+            if(!CUHDContainer::write(RANGE_CONTAINER, data->data(), size,
+                NUM_STATES, size / 7 + 3, interval)) {
+                std::cout << "mismatch" << std::endl;
+                continue;
+            }
+            
+            auto container = CUHDContainer::open(RANGE_CONTAINER);
+            
+            if(!container) {
+                std::cout << "mismatch" << std::endl;
+                continue;
+            }
+            
+            std::vector<size_t> blocks;
+            
+            for(size_t i = 0; i < container->get_num_blocks(); ++i)
+                blocks.push_back(container->get_block_begin(i));
+            
+            for(auto& slice : get_range_slices(size, blocks, SEED + 1)) {
+                if(range_matches(data, slice.first, slice.second,
+                    [&](size_t begin, size_t count, SYMBOL_TYPE* out) {
+                        container->decode_range(begin, count, out);}));
+                else std::cout << "mismatch" << std::endl;
+            }
+        }
+        
+        std::remove(RANGE_CONTAINER);
+    }
+}
+#endif
+
+// same decoder items, transforms and next states
+bool tables_equal(std::shared_ptr<CUHDCodetable> a,
+    std::shared_ptr<ANSEncoderTable> a_encoder,
+    std::shared_ptr<CUHDCodetable> b,
+    std::shared_ptr<ANSEncoderTable> b_encoder) {
+    
+    if(!a || !b || !a_encoder || !b_encoder
+        || a->get_num_entries() != b->get_num_entries()
+        || a_encoder->number_of_states != b_encoder->number_of_states
+        || a_encoder->number_of_symbols != b_encoder->number_of_symbols
+        || a_encoder->next_state != b_encoder->next_state)
+        return false;
+    
+    for(size_t i = 0; i < a->get_num_entries(); ++i) {
+        const CUHDCodetableItem& x = a->get()[i];
+        const CUHDCodetableItem& y = b->get()[i];
+        
+        if(x.next_state != y.next_state || x.symbol != y.symbol
+            || x.min_num_bits != y.min_num_bits)
+            return false;
+    }
+    
+    for(size_t i = 0; i < a_encoder->number_of_symbols; ++i) {
+        const ANSEncoderTable::ANSSymbolTransform& x
+            = a_encoder->transform[i];
+        const ANSEncoderTable::ANSSymbolTransform& y
+            = b_encoder->transform[i];
+        
+        if(x.delta_num_bits != y.delta_num_bits
+            || x.delta_find_state != y.delta_find_state
+            || x.num_states != y.num_states)
+            return false;
+    }
+    
+    return true;
+}
+
+// writes the first size bytes of file, changed by corrupt, to
+// CORRUPT_TABLE_FILE and returns whether opening it fails
+bool rejects(const std::vector<char>& file, size_t size,
+    std::function<void(char*)> corrupt) {
+    
+    std::vector<char> copy(file.begin(), file.begin() + size);
+    corrupt(copy.data());
+    
+    std::ofstream stream(CORRUPT_TABLE_FILE, std::ios::binary);
+    stream.write(copy.data(), copy.size());
+    stream.close();
+    
+    return !CUHDTableFile::open(CORRUPT_TABLE_FILE);
+}
+
+// writes packed and counts table files, reopens them and compares their
+// tables with the originals, truncated and corrupted packed files must not
+// open
+void check_table_files() {
+    auto dist = ANSTableGenerator::generate_distribution(
+        SEED, NUM_SYMBOLS, NUM_STATES,
+        [](double x) {return STREAM_LAMBDA * exp(-STREAM_LAMBDA * x);});
+    auto encoder_table = ANSTableGenerator::generate_encoder_table(
+        ANSTableGenerator::generate_table(dist.prob, dist.dist, nullptr,
+            NUM_SYMBOLS, NUM_STATES));
+    auto decoder_table = ANSTableGenerator::get_decoder_table(encoder_table);
+    
+    if(!CUHDTableFile::write(PACKED_TABLE_FILE, encoder_table, decoder_table)
+        || !CUHDTableFile::write(COUNTS_TABLE_FILE, dist.dist, nullptr)) {
+        std::cout << "mismatch" << std::endl;
+        return;
+    }
+    
+    auto packed = CUHDTableFile::open(PACKED_TABLE_FILE);
+    auto counts = CUHDTableFile::open(COUNTS_TABLE_FILE);
+    
+    for(auto file : {packed, counts}) {
+        if(file && tables_equal(decoder_table, encoder_table,
+            file->get_decoder_table(), file->get_encoder_table()));
+        else std::cout << "mismatch" << std::endl;
+    }
+    
+    if(!packed || packed->get_contents() != CUHD_TABLE_FILE_PACKED
+        || !counts || counts->get_contents() != CUHD_TABLE_FILE_COUNTS)
+        std::cout << "mismatch" << std::endl;
+    
+    packed.reset();
+    counts.reset();
+    
+    std::ifstream stream(PACKED_TABLE_FILE, std::ios::binary);
+    std::vector<char> file((std::istreambuf_iterator<char>(stream)),
+        std::istreambuf_iterator<char>());
+    
+    CUHDTableFileHeader header;
+    std::copy(file.begin(), file.begin() + sizeof(header), (char*) &header);
+    
+    auto unchanged = [](char*) {};
+    
+    // the file itself opens, all of its truncations must not
+    bool ok = !rejects(file, file.size(), unchanged);
+    
+    for(size_t size : {(size_t) 0, sizeof(header) - 1, sizeof(header),
+        (size_t) header.items, (size_t) header.transforms,
+        (size_t) header.next_states, file.size() - 1})
+        ok &= rejects(file, size, unchanged);
+    
+    // an item of another symbol than item 0
+    size_t other = 1;
+    
+    while(decoder_table->get()[other].symbol == decoder_table->get()[0].symbol)
+        ++other;
+    
+    auto item = [&](char* f, size_t i) {
+        return (CUHDCodetableItem*) (f + header.items) + i;};
+    auto transform = [&](char* f, size_t i) {
+        return (ANSEncoderTable::ANSSymbolTransform*)
+            (f + header.transforms) + i;};
+    
+    const std::vector<std::function<void(char*)>> corruptions = {
+        [](char* f) {f[0] ^= 1;},
+        [](char* f) {((CUHDTableFileHeader*) f)->version += 1;},
+        [](char* f) {((CUHDTableFileHeader*) f)->contents = 2;},
+        [](char* f) {((CUHDTableFileHeader*) f)->symbol_size += 1;},
+        [](char* f) {((CUHDTableFileHeader*) f)->num_states += 1;},
+        [](char* f) {((CUHDTableFileHeader*) f)->file_size += 1;},
+        [](char* f) {((CUHDTableFileHeader*) f)->items += 1;},
+        [&](char* f) {item(f, 7)->next_state = 0;},
+        [&](char* f) {item(f, 7)->min_num_bits += 1;},
+        [&](char* f) {
+            std::swap(item(f, 0)->symbol, item(f, other)->symbol);},
+        [&](char* f) {
+            ((std::uint32_t*) (f + header.next_states))[5] ^= 1;},
+        [&](char* f) {transform(f, 0)->delta_find_state += 1;}};
+    
+    for(auto& corrupt : corruptions)
+        ok &= rejects(file, file.size(), corrupt);
+    
+    if(!ok) std::cout << "mismatch" << std::endl;
+    
+    std::remove(PACKED_TABLE_FILE);
+    std::remove(COUNTS_TABLE_FILE);
+    std::remove(CORRUPT_TABLE_FILE);
+}
+
+// construction time of the tables of num_symbols Zipf-distributed symbols
+// for increasing state counts, the heap-based builder against the linear one
+template<typename Types>
+void run_tables(size_t num_symbols, size_t num_threads) {
+    
+    typedef ANSBasicTableGenerator<Types> Generator;
+    
+    std::cout << num_symbols << " symbols" << std::endl;
+    
+    // print column headers
+    std::cout << "states | time [linear] (\u03BCs) | time [heap] (\u03BCs) | ";
+    std::cout << "time [encoder table] (\u03BCs) | ";
+    std::cout << "time [decoder table] (\u03BCs) | ";
+    std::cout << "time [decoder table, " << num_threads
+        << " threads] (\u03BCs)";
+    std::cout << std::endl << std::endl;
+    
+    size_t bits = MIN_STATE_BITS;
+    while(((size_t) 1 << bits) < num_symbols) ++bits;
+    
+    for(; bits <= MAX_STATE_BITS; ++bits) {
+        const size_t num_states = 1 << bits;
+        std::vector<std::pair<std::string, size_t>> timings;
+        
+        auto dist = Generator::generate_distribution(SEED, num_symbols,
+            num_states, [](double x) {return std::pow(x + 1, -ZIPF_EXPONENT);});
+        
+        std::shared_ptr<typename Generator::Symbol_Spread> linear, table;
+        
+        const bool run_linear = num_states * num_symbols <= MAX_LINEAR_STEPS;
+        
+        if(run_linear) {
+            TIMER_START(timings, "linear")
+            linear = Generator::generate_table_linear(dist.prob, dist.dist,
+                nullptr, num_symbols, num_states);
+            TIMER_STOP
+        }
+        
+        TIMER_START(timings, "heap")
+        table = Generator::generate_table(dist.prob, dist.dist,
+            nullptr, num_symbols, num_states);
+        TIMER_STOP
+        
+        std::shared_ptr<typename Generator::EncoderTable> encoder_table;
+        
+        TIMER_START(timings, "encoder table")
+        encoder_table = Generator::generate_encoder_table(table);
+        TIMER_STOP
+        
+        std::shared_ptr<typename Generator::Codetable> decoder_table,
+            parallel_table;
+        
+        TIMER_START(timings, "decoder table")
+        decoder_table = Generator::get_decoder_table(encoder_table);
+        TIMER_STOP
+        
+        TIMER_START(timings, "parallel decoder table")
+        parallel_table = Generator::get_decoder_table(encoder_table,
+            num_threads);
+        TIMER_STOP
+        
+        std::cout << std::left << std::setw(10) << num_states;
+        if(!run_linear) std::cout << std::left << std::setw(10) << "-";
+        
+        for(auto& t : timings)
+            std::cout << std::left << std::setw(10) << t.second;
+        
+        // both builders must produce the same spread, and the threads
+        // the same decoder table
+        if(run_linear && !Generator::equals(linear, table))
+            std::cout << "mismatch";
+        
+        auto* a = decoder_table->get();
+        auto* b = parallel_table->get();
+        
+        for(size_t i = 0; i < num_states; ++i) {
+            if(a[i].next_state != b[i].next_state || a[i].symbol != b[i].symbol
+                || a[i].min_num_bits != b[i].min_num_bits) {
+                std::cout << "mismatch";
+                break;
+            }
+        }
+        
+        std::cout << std::endl;
+    }
+    
+    std::cout << std::endl;
 }
 
 int main(int argc, char **argv) {
@@ -173,7 +1016,7 @@ int main(int argc, char **argv) {
     auto print_help = [&]() {
         std::cout << "USAGE: " << bin << " <compute device index> "
             << "<size of input in megabytes> "
-            << "<number of CPU threads>" << std::endl;
+            << "<number of CPU threads> [states|tables]" << std::endl;
     };
 
     if(argc < 4) {print_help(); return 1;}
@@ -199,8 +1042,37 @@ int main(int argc, char **argv) {
 	#ifdef CUDA
 	cudaSetDevice(compute_device_id);
 	#endif
+
+	// buffers of the same size are reused for each dataset, large ones
+	// are backed by huge pages
+	CUHDAllocator::set_default(std::make_shared<CUHDPoolAllocator>(
+	    std::make_shared<CUHDHugePageAllocator>()));
+
+	// run the test, or the benchmark of the table sizes or of the table
+	// construction
+	if(argc > 4 && std::string(argv[4]) == "tables") {
+	    run_tables<CUHDUnit32Symbol8Wide>(NUM_SYMBOLS, threads);
+	    run_tables<CUHDUnit32Symbol16Wide>(NUM_WIDE_SYMBOLS, threads);
+	    return 0;
+	}
+	
+	#ifdef MULTI
+	if(argc > 4 && std::string(argv[4]) == "states") {
+	    run_states(size, threads);
+	    return 0;
+	}
+	#endif
 	
-	// run the test
+    #ifdef MULTI
+    check_single_symbol(threads);
+    check_skewed();
+    check_speculative_fallback();
+    check_stream();
+    check_ranges();
+    #endif
+    
+    check_table_files();
+    
     run(size, threads);
     
     return 0;
@@ -0,0 +1,174 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "cuhd_allocator.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include <sys/mman.h>
+
+namespace {
+    std::shared_ptr<CUHDAllocator> default_allocator
+        = std::make_shared<CUHDAlignedAllocator>();
+
+    std::mutex default_mutex;
+}
+
+std::shared_ptr<CUHDAllocator> CUHDAllocator::get_default() {
+    std::lock_guard<std::mutex> lock(default_mutex);
+    return default_allocator;
+}
+
+void CUHDAllocator::set_default(std::shared_ptr<CUHDAllocator> allocator) {
+    std::lock_guard<std::mutex> lock(default_mutex);
+
+    if(allocator) default_allocator = allocator;
+    else default_allocator = std::make_shared<CUHDAlignedAllocator>();
+}
+
+void* CUHDAlignedAllocator::allocate(size_t bytes) {
+    void* ptr = nullptr;
+
+    if(posix_memalign(&ptr, CUHD_ALLOCATOR_ALIGNMENT,
+        bytes > 0 ? bytes : 1) != 0) throw std::bad_alloc();
+
+    return ptr;
+}
+
+void CUHDAlignedAllocator::deallocate(void* ptr, size_t) {
+    free(ptr);
+}
+
+size_t CUHDHugePageAllocator::get_page_size() {
+    return 2 << 20;
+}
+
+void* CUHDHugePageAllocator::allocate(size_t bytes) {
+    const size_t page = get_page_size();
+
+    if(bytes < page) return small_.allocate(bytes);
+
+    const size_t size = (bytes + page - 1) / page * page;
+    void* ptr = MAP_FAILED;
+
+    // reserved huge pages
+    #ifdef MAP_HUGETLB
+    ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(ptr != MAP_FAILED) return ptr;
+    #endif
+
+    // transparent huge pages need a region aligned to the huge page size,
+    // map one page more and unmap what is in front of and behind it
+    ptr = mmap(nullptr, size + page, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ptr == MAP_FAILED) throw std::bad_alloc();
+
+    const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(ptr);
+    const std::uintptr_t aligned = (begin + page - 1) / page * page;
+
+    if(aligned > begin) munmap(ptr, aligned - begin);
+    munmap(reinterpret_cast<void*>(aligned + size), page - (aligned - begin));
+
+    ptr = reinterpret_cast<void*>(aligned);
+
+    #ifdef MADV_HUGEPAGE
+    madvise(ptr, size, MADV_HUGEPAGE);
+    #endif
+
+    return ptr;
+}
+
+void CUHDHugePageAllocator::deallocate(void* ptr, size_t bytes) {
+    const size_t page = get_page_size();
+
+    if(bytes < page) small_.deallocate(ptr, bytes);
+    else munmap(ptr, (bytes + page - 1) / page * page);
+}
+
+CUHDPoolAllocator::CUHDPoolAllocator(std::shared_ptr<CUHDAllocator> upstream)
+    : upstream_(upstream),
+      free_((sizeof(size_t) * 8 - 6) * 4 + 1),
+      cached_size_(0) {
+
+    if(!upstream_) upstream_ = std::make_shared<CUHDAlignedAllocator>();
+}
+
+CUHDPoolAllocator::~CUHDPoolAllocator() {
+    release();
+}
+
+size_t CUHDPoolAllocator::get_size_class(size_t bytes) {
+    if(bytes <= 64) return 0;
+
+    // the highest bit of bytes - 1 and the two bits below it
+    size_t top = 6;
+    while((bytes - 1) >> (top + 1)) ++top;
+
+    const size_t quarter = ((bytes - 1) >> (top - 2)) & 3;
+
+    return (top - 6) * 4 + quarter + 1;
+}
+
+size_t CUHDPoolAllocator::get_class_size(size_t size_class) {
+    if(size_class == 0) return 64;
+
+    const size_t top = (size_class - 1) / 4 + 6;
+    const size_t quarter = (size_class - 1) % 4;
+
+    return (4 + quarter + 1) << (top - 2);
+}
+
+void* CUHDPoolAllocator::allocate(size_t bytes) {
+    const size_t size_class = get_size_class(bytes);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<void*>& blocks = free_.at(size_class);
+
+        if(!blocks.empty()) {
+            void* ptr = blocks.back();
+            blocks.pop_back();
+            cached_size_ -= get_class_size(size_class);
+
+            return ptr;
+        }
+    }
+
+    return upstream_->allocate(get_class_size(size_class));
+}
+
+void CUHDPoolAllocator::deallocate(void* ptr, size_t bytes) {
+    const size_t size_class = get_size_class(bytes);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.at(size_class).push_back(ptr);
+    cached_size_ += get_class_size(size_class);
+}
+
+void CUHDPoolAllocator::release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for(size_t i = 0; i < free_.size(); ++i) {
+        for(void* ptr : free_[i])
+            upstream_->deallocate(ptr, get_class_size(i));
+
+        free_[i].clear();
+    }
+
+    cached_size_ = 0;
+}
+
+size_t CUHDPoolAllocator::get_cached_size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_size_;
+}
@@ -10,31 +10,47 @@
 
 #include "cuhd_codetable.h"
 
-CUHDCodetable::CUHDCodetable(size_t num_entries)
+template<typename Types>
+CUHDBasicCodetable<Types>::CUHDBasicCodetable(size_t num_entries,
+    std::shared_ptr<CUHDAllocator> allocator)
     : size_(num_entries),
       num_entries_(num_entries) {
       
-      std::shared_ptr<CUHDCodetableItem[]> table(
-        new CUHDCodetableItem[get_size()]);
+      std::shared_ptr<Item[]> table
+        = CUHDAllocator::allocate_array<Item>(get_size(), allocator);
      
-     std::memset(table.get(), 0, get_size() * sizeof(CUHDCodetableItem));
+     std::memset(table.get(), 0, get_size() * sizeof(Item));
      
      table_ = table;
 }
 
-size_t CUHDCodetable::get_size() {
+template<typename Types>
+CUHDBasicCodetable<Types>::CUHDBasicCodetable(std::shared_ptr<Item[]> table,
+    size_t num_entries)
+    : size_(num_entries),
+      num_entries_(num_entries),
+      table_(table) {
+
+}
+
+template<typename Types>
+size_t CUHDBasicCodetable<Types>::get_size() {
     return size_;
 }
 
-size_t CUHDCodetable::get_num_entries() {
+template<typename Types>
+size_t CUHDBasicCodetable<Types>::get_num_entries() {
     return num_entries_;
 }
 
-size_t CUHDCodetable::get_max_codeword_length() {
-    return MAX_CODEWORD_LENGTH;
+template<typename Types>
+size_t CUHDBasicCodetable<Types>::get_max_codeword_length() {
+    return Types::max_codeword_length;
 }
 
-CUHDCodetableItem* CUHDCodetable::get() {
+template<typename Types>
+typename CUHDBasicCodetable<Types>::Item* CUHDBasicCodetable<Types>::get() {
     return table_.get();
 }
 
+CUHD_INSTANTIATE(CUHDBasicCodetable)
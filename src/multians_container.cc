@@ -0,0 +1,580 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "cuhd_container.h"
+#include "multicore_decoder_session.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+    const char header_magic[8] = {'M', 'U', 'L', 'T', 'I', 'A', 'N', 'C'};
+    const char trailer_magic[8] = {'M', 'U', 'L', 'T', 'I', 'E', 'N', 'D'};
+
+    size_t align(size_t offset) {
+        return (offset + CUHD_ALLOCATOR_ALIGNMENT - 1)
+            / CUHD_ALLOCATOR_ALIGNMENT * CUHD_ALLOCATOR_ALIGNMENT;
+    }
+
+    template<typename Types>
+    CUHDContainerHeader get_header() {
+        CUHDContainerHeader header;
+        std::memset(&header, 0, sizeof(CUHDContainerHeader));
+
+        std::memcpy(header.magic, header_magic, sizeof(header_magic));
+        header.version = CUHD_CONTAINER_VERSION;
+
+        header.unit_size = sizeof(typename Types::unit_type);
+        header.state_size = sizeof(typename Types::state_type);
+        header.symbol_size = sizeof(typename Types::symbol_type);
+        header.table_state_size = sizeof(typename Types::table_state_type);
+
+        return header;
+    }
+
+    // output stream which keeps track of the offset and pads sections to
+    // the alignment
+    struct Writer {
+        std::ofstream out;
+        size_t offset;
+
+        void write(const void* data, size_t bytes) {
+            out.write(static_cast<const char*>(data), bytes);
+            offset += bytes;
+        }
+
+        // returns the aligned offset
+        size_t pad() {
+            const char zero[CUHD_ALLOCATOR_ALIGNMENT] = {0};
+            const size_t aligned = align(offset);
+
+            write(zero, aligned - offset);
+
+            return aligned;
+        }
+    };
+}
+
+template<typename Types>
+CUHDBasicContainer<Types>::CUHDBasicContainer(
+    std::shared_ptr<CUHDMappedFile> file)
+    : file_(file),
+      header_(nullptr),
+      blocks_(nullptr) {
+
+}
+
+template<typename Types>
+bool CUHDBasicContainer<Types>::write(const std::string& path,
+    symbol_type* in, size_t size,
+    size_t num_states,
+    size_t block_size,
+    size_t checkpoint_interval,
+    size_t num_threads) {
+
+    typedef typename Types::unit_type unit_type;
+
+    assert(block_size > 0 && num_threads > 0);
+
+    Writer w;
+    w.out.open(path, std::ios::binary | std::ios::trunc);
+    w.offset = 0;
+
+    if(!w.out) return false;
+
+    CUHDContainerHeader header = get_header<Types>();
+    header.size = size;
+    header.block_size = block_size;
+    header.num_blocks = SDIV(size, block_size);
+    header.checkpoint_interval = checkpoint_interval;
+
+    std::shared_ptr<EncoderTable> encoder_table;
+    std::vector<std::uint32_t> table;
+
+    // one table for all blocks, the counts are stored
+    if(size > 0) {
+        // any seed, the resulting counts are stored
+        typename Generator::Distribution dist
+            = Generator::generate_distribution_from_buffer(
+                0, num_states, in, size);
+
+        const size_t num_symbols = dist.dist->size();
+
+        encoder_table = Generator::generate_encoder_table(
+            Generator::generate_table(dist.prob, dist.dist, dist.symbols,
+                num_symbols, num_states));
+
+        table.resize(2 * num_symbols);
+
+        std::copy(dist.symbols->begin(), dist.symbols->end(), table.begin());
+        std::copy(dist.dist->begin(), dist.dist->end(),
+            table.begin() + num_symbols);
+
+        header.num_states = num_states;
+        header.num_table_symbols = num_symbols;
+        header.table = align(sizeof(CUHDContainerHeader));
+    }
+
+    w.write(&header, sizeof(CUHDContainerHeader));
+
+    if(!table.empty()) {
+        w.pad();
+        w.write(table.data(), table.size() * sizeof(std::uint32_t));
+    }
+
+    std::vector<CUHDContainerBlock> blocks(header.num_blocks);
+
+    // each thread encodes into its own buffer, which is large enough for
+    // all blocks
+    num_threads = std::min<size_t>(num_threads,
+        std::max<size_t>(header.num_blocks, 1));
+
+    const size_t buffer_size = size > 0 ?
+        Encoder::get_buffer_size(encoder_table, block_size) : 0;
+
+    std::vector<std::shared_ptr<unit_type[]>> buffers(num_threads);
+    std::vector<std::shared_ptr<InputBuffer>> encoded(num_threads);
+
+    for(auto& buffer : buffers)
+        buffer = CUHDAllocator::allocate_array<unit_type>(buffer_size);
+
+    const unit_type padding[INPUT_BUFFER_PADDING] = {0};
+
+    for(size_t first = 0; first < header.num_blocks; first += num_threads) {
+        const size_t count = std::min<size_t>(num_threads,
+            header.num_blocks - first);
+
+        auto encode = [&](size_t i) {
+            const size_t begin = (first + i) * block_size;
+            const size_t num_symbols = std::min(block_size, size - begin);
+
+            encoded[i] = Encoder::encode_into(in + begin, num_symbols,
+                encoder_table, checkpoint_interval, buffers[i],
+                buffer_size);
+        };
+
+        std::vector<std::thread> threads;
+
+        for(size_t i = 1; i < count; ++i)
+            threads.push_back(std::thread(encode, i));
+
+        encode(0);
+
+        for(std::thread& thread : threads) thread.join();
+
+        // the blocks are written in order
+        for(size_t i = 0; i < count; ++i) {
+            const size_t index = first + i;
+            InputBuffer& buffer = *encoded[i];
+
+            CUHDContainerBlock& block = blocks[index];
+            block.offset = w.pad();
+            block.size = buffer.get_compressed_size();
+            block.num_symbols = std::min(block_size,
+                size - index * block_size);
+            block.first_state = buffer.get_first_state();
+            block.first_bit = buffer.get_first_bit();
+
+            w.write(buffer.get_compressed_data(),
+                block.size * sizeof(unit_type));
+            w.write(padding, sizeof(padding));
+
+            auto index_ptr = buffer.get_sync_index();
+            if(!index_ptr) continue;
+
+            std::vector<CUHDContainerCheckpoint> checkpoints;
+            checkpoints.reserve(index_ptr->get_num_checkpoints());
+
+            for(size_t j = 0; j < index_ptr->get_num_checkpoints(); ++j) {
+                const auto& c = index_ptr->get()[j];
+                checkpoints.push_back({(std::uint32_t) c.state,
+                    (std::uint32_t) c.bit, c.unit, c.output_offset});
+            }
+
+            block.checkpoints = w.pad();
+            block.num_checkpoints = checkpoints.size();
+
+            w.write(checkpoints.data(),
+                checkpoints.size() * sizeof(CUHDContainerCheckpoint));
+        }
+    }
+
+    CUHDContainerTrailer trailer;
+    std::memcpy(trailer.magic, trailer_magic, sizeof(trailer_magic));
+
+    trailer.block_index = w.pad();
+    w.write(blocks.data(), blocks.size() * sizeof(CUHDContainerBlock));
+
+    trailer.file_size = w.offset + sizeof(CUHDContainerTrailer);
+    w.write(&trailer, sizeof(CUHDContainerTrailer));
+
+    return (bool) w.out.flush();
+}
+
+template<typename Types>
+std::shared_ptr<CUHDBasicContainer<Types>> CUHDBasicContainer<Types>::open(
+    const std::string& path) {
+
+    std::shared_ptr<CUHDMappedFile> file = CUHDMappedFile::open(path);
+    if(!file) return nullptr;
+
+    std::shared_ptr<CUHDBasicContainer> container(
+        new CUHDBasicContainer(file));
+
+    if(!container->load()) return nullptr;
+
+    return container;
+}
+
+template<typename Types>
+bool CUHDBasicContainer<Types>::load() {
+    typedef typename Types::unit_type unit_type;
+
+    const size_t file_size = file_->get_size();
+    const std::uint8_t* data = file_->get();
+
+    if(file_size < sizeof(CUHDContainerHeader) + sizeof(CUHDContainerTrailer))
+        return false;
+
+    header_ = reinterpret_cast<const CUHDContainerHeader*>(data);
+
+    const CUHDContainerTrailer* trailer
+        = reinterpret_cast<const CUHDContainerTrailer*>(
+            data + file_size - sizeof(CUHDContainerTrailer));
+
+    const CUHDContainerHeader expected = get_header<Types>();
+
+    if(std::memcmp(header_->magic, header_magic, sizeof(header_magic)) != 0
+        || std::memcmp(trailer->magic, trailer_magic,
+            sizeof(trailer_magic)) != 0
+        || header_->version != CUHD_CONTAINER_VERSION
+        || header_->unit_size != expected.unit_size
+        || header_->state_size != expected.state_size
+        || header_->symbol_size != expected.symbol_size
+        || header_->table_state_size != expected.table_state_size
+        || trailer->file_size != file_size) return false;
+
+    // the sections lie between the header and the trailer
+    const size_t end = file_size - sizeof(CUHDContainerTrailer);
+
+    auto fits = [&](std::uint64_t offset, std::uint64_t count,
+        size_t element_size) {
+        return offset >= sizeof(CUHDContainerHeader)
+            && offset % CUHD_ALLOCATOR_ALIGNMENT == 0 && offset <= end
+            && count <= (end - offset) / element_size;
+    };
+
+    const size_t num_blocks = header_->num_blocks;
+    const size_t block_size = header_->block_size;
+    const size_t size = header_->size;
+
+    if(block_size == 0 || num_blocks != SDIV(size, block_size)
+        || !fits(trailer->block_index, num_blocks,
+            sizeof(CUHDContainerBlock))) return false;
+
+    blocks_ = reinterpret_cast<const CUHDContainerBlock*>(
+        data + trailer->block_index);
+
+    if(num_blocks == 0) return true;
+
+    // the table, rebuilt from the counts
+    const size_t num_states = header_->num_states;
+    const size_t num_symbols = header_->num_table_symbols;
+
+    // a table of a single symbol has only 0-bit codewords, see
+    // ANSBasicTableGenerator::generate_distribution_from_buffer
+    if(num_states == 0 || num_states > Types::max_num_states
+        || (num_states & (num_states - 1)) != 0
+        || num_symbols < 2 || num_symbols > num_states
+        || !fits(header_->table, 2 * num_symbols, sizeof(std::uint32_t)))
+        return false;
+
+    const std::uint32_t* symbols = reinterpret_cast<const std::uint32_t*>(
+        data + header_->table);
+    const std::uint32_t* counts = symbols + num_symbols;
+
+    auto prob = std::make_shared<std::vector<double>>(num_symbols);
+    auto dist = std::make_shared<std::vector<size_t>>(num_symbols);
+    auto syms = std::make_shared<std::vector<symbol_type>>(num_symbols);
+
+    size_t sum = 0;
+
+    for(size_t i = 0; i < num_symbols; ++i) {
+        if(counts[i] == 0 || counts[i] > num_states || symbols[i]
+            >= ((size_t) 1 << (sizeof(symbol_type) * 8))) return false;
+
+        (*prob)[i] = (double) counts[i] / num_states;
+        (*dist)[i] = counts[i];
+        (*syms)[i] = symbols[i];
+
+        sum += counts[i];
+    }
+
+    if(sum != num_states) return false;
+
+    encoder_table_ = Generator::generate_encoder_table(
+        Generator::generate_table(prob, dist, syms, num_symbols,
+            num_states));
+    decoder_table_ = Generator::get_decoder_table(encoder_table_);
+
+    // the blocks, the decoders must not leave the mapping
+    const size_t unit_bits = sizeof(unit_type) * 8;
+
+    for(size_t i = 0; i < num_blocks; ++i) {
+        const CUHDContainerBlock& block = blocks_[i];
+
+        if(block.num_symbols != get_block_size(i)
+            || block.size == 0
+            || !fits(block.offset, block.size + INPUT_BUFFER_PADDING,
+                sizeof(unit_type))
+            || block.first_state < num_states
+            || block.first_state >= 2 * num_states
+            || block.first_bit > unit_bits
+            || (block.first_bit == 0 && block.size > 1)) return false;
+
+        if(block.num_checkpoints == 0) continue;
+
+        if(!fits(block.checkpoints, block.num_checkpoints,
+            sizeof(CUHDContainerCheckpoint))) return false;
+
+        const CUHDContainerCheckpoint* checkpoints
+            = reinterpret_cast<const CUHDContainerCheckpoint*>(
+                data + block.checkpoints);
+
+        for(size_t j = 0; j < block.num_checkpoints; ++j) {
+            const CUHDContainerCheckpoint& c = checkpoints[j];
+
+            if(c.state < num_states || c.state >= 2 * num_states
+                || c.bit >= unit_bits || c.unit > block.size
+                || c.output_offset > block.num_symbols
+                || (j > 0 && c.output_offset
+                    < checkpoints[j - 1].output_offset)) return false;
+        }
+    }
+
+    return true;
+}
+
+template<typename Types>
+size_t CUHDBasicContainer<Types>::get_size() {
+    return header_->size;
+}
+
+template<typename Types>
+size_t CUHDBasicContainer<Types>::get_num_blocks() {
+    return header_->num_blocks;
+}
+
+template<typename Types>
+size_t CUHDBasicContainer<Types>::get_block_begin(size_t block) {
+    return block * header_->block_size;
+}
+
+template<typename Types>
+size_t CUHDBasicContainer<Types>::get_block_size(size_t block) {
+    return std::min<size_t>(header_->block_size,
+        header_->size - get_block_begin(block));
+}
+
+template<typename Types>
+void CUHDBasicContainer<Types>::prefetch(size_t first_block,
+    size_t num_blocks) {
+
+    typedef typename Types::unit_type unit_type;
+
+    if(num_blocks == 0) return;
+
+    assert(first_block + num_blocks <= get_num_blocks());
+
+    const CUHDContainerBlock& last = blocks_[first_block + num_blocks - 1];
+    const size_t begin = blocks_[first_block].offset;
+    const size_t end = last.offset
+        + (last.size + INPUT_BUFFER_PADDING) * sizeof(unit_type);
+
+    file_->prefetch(begin, end - begin);
+}
+
+template<typename Types>
+std::shared_ptr<typename CUHDBasicContainer<Types>::InputBuffer>
+    CUHDBasicContainer<Types>::get_block(size_t block) {
+
+    typedef typename Types::unit_type unit_type;
+    typedef typename InputBuffer::SyncIndex SyncIndex;
+
+    assert(block < get_num_blocks());
+
+    const CUHDContainerBlock& b = blocks_[block];
+    const std::uint8_t* data = file_->get();
+
+    // the decoders only read the units
+    std::shared_ptr<unit_type[]> units(file_, const_cast<unit_type*>(
+        reinterpret_cast<const unit_type*>(data + b.offset)));
+
+    std::shared_ptr<InputBuffer> buffer = std::make_shared<InputBuffer>(
+        units, 0, b.size, b.first_bit, b.first_state);
+
+    if(b.num_checkpoints > 0) {
+        const CUHDContainerCheckpoint* checkpoints
+            = reinterpret_cast<const CUHDContainerCheckpoint*>(
+                data + b.checkpoints);
+
+        std::vector<typename SyncIndex::Checkpoint> index(b.num_checkpoints);
+
+        for(size_t i = 0; i < b.num_checkpoints; ++i) {
+            index[i] = {checkpoints[i].state, checkpoints[i].bit,
+                checkpoints[i].unit, checkpoints[i].output_offset};
+        }
+
+        buffer->set_sync_index(std::make_shared<SyncIndex>(index,
+            header_->checkpoint_interval, b.num_symbols));
+    }
+
+    return buffer;
+}
+
+template<typename Types>
+std::shared_ptr<typename CUHDBasicContainer<Types>::Codetable>
+    CUHDBasicContainer<Types>::get_decoder_table() {
+    return decoder_table_;
+}
+
+template<typename Types>
+std::shared_ptr<typename CUHDBasicContainer<Types>::EncoderTable>
+    CUHDBasicContainer<Types>::get_encoder_table() {
+    return encoder_table_;
+}
+
+template<typename Types>
+void CUHDBasicContainer<Types>::decode(symbol_type* out,
+    size_t num_threads, MulticoreDecoderOptions options) {
+
+    decode(0, get_num_blocks(), out, num_threads, options);
+}
+
+template<typename Types>
+void CUHDBasicContainer<Types>::decode(size_t first_block,
+    size_t num_blocks, symbol_type* out, size_t num_threads,
+    MulticoreDecoderOptions options) {
+
+    typedef MulticoreBasicDecoderSession<Types> Session;
+    typedef typename Decoder::OutputBuffer OutputBuffer;
+
+    assert(first_block + num_blocks <= get_num_blocks());
+
+    if(num_blocks == 0) return;
+
+    const size_t out_begin = get_block_begin(first_block);
+
+    // the blocks are decoded into out directly
+    options.forward_output = true;
+
+    auto decode_block = [&](Session& session, size_t block) {
+        std::shared_ptr<InputBuffer> in = get_block(block);
+        std::shared_ptr<OutputBuffer> output = std::make_shared<OutputBuffer>(
+            out + (get_block_begin(block) - out_begin),
+            get_block_size(block));
+
+        session.decode(CUHD_CONTAINER_SUBSEQUENCE_SIZE,
+            in->get_compressed_size(), output, in, decoder_table_);
+    };
+
+    // one block per thread at a time
+    if(num_threads > 1 && num_blocks >= num_threads) {
+        std::atomic<size_t> next(0);
+
+        auto work = [&]() {
+            Session session(1, options);
+
+            for(size_t i = next++; i < num_blocks; i = next++)
+                decode_block(session, first_block + i);
+        };
+
+        std::vector<std::thread> threads;
+
+        for(size_t i = 1; i < num_threads; ++i)
+            threads.push_back(std::thread(work));
+
+        work();
+
+        for(std::thread& thread : threads) thread.join();
+
+        return;
+    }
+
+    // all threads on each block, blocks with fewer subsequences than
+    // threads are decoded by a single thread
+    std::unique_ptr<Session> session(new Session(num_threads, options));
+    std::unique_ptr<Session> single;
+
+    for(size_t block = first_block; block < first_block + num_blocks;
+        ++block) {
+        const size_t num_subsequences = SDIV(blocks_[block].size,
+            CUHD_CONTAINER_SUBSEQUENCE_SIZE);
+
+        if(num_subsequences >= num_threads) {
+            decode_block(*session, block);
+            continue;
+        }
+
+        if(!single) single.reset(new Session(1, options));
+        decode_block(*single, block);
+    }
+}
+
+template<typename Types>
+void CUHDBasicContainer<Types>::decode_range(size_t begin, size_t count,
+    symbol_type* out) {
+
+    typedef typename Decoder::OutputBuffer OutputBuffer;
+
+    assert(begin + count <= get_size());
+
+    if(count == 0) return;
+
+    const size_t block_size = header_->block_size;
+    const size_t last = (begin + count - 1) / block_size;
+
+    for(size_t block = begin / block_size; block <= last; ++block) {
+        const size_t block_begin = get_block_begin(block);
+        const size_t first = std::max(begin, block_begin);
+        const size_t num_symbols = std::min(begin + count,
+            block_begin + get_block_size(block)) - first;
+
+        std::shared_ptr<InputBuffer> in = get_block(block);
+        symbol_type* dest = out + (first - begin);
+
+        if(in->get_sync_index()) {
+            Decoder::decode_range(in, decoder_table_, first - block_begin,
+                num_symbols, dest);
+            continue;
+        }
+
+        // the whole block, of which the range is copied
+        std::shared_ptr<OutputBuffer> output
+            = std::make_shared<OutputBuffer>(get_block_size(block));
+
+        MulticoreDecoderOptions options;
+        options.forward_output = true;
+
+        Decoder::decode(CUHD_CONTAINER_SUBSEQUENCE_SIZE, 1,
+            in->get_compressed_size(), output, in, decoder_table_, options);
+
+        const symbol_type* symbols
+            = output->get_decompressed_data().get() + (first - block_begin);
+        std::copy(symbols, symbols + num_symbols, dest);
+    }
+}
+
+CUHD_INSTANTIATE(CUHDBasicContainer)
@@ -0,0 +1,106 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "cuhd_dispatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+    CUHDInstructionSet detect() {
+        #ifdef MULTIANS_SIMD
+        __builtin_cpu_init();
+
+        const bool avx2 = __builtin_cpu_supports("avx2")
+            && __builtin_cpu_supports("bmi")
+            && __builtin_cpu_supports("bmi2")
+            && __builtin_cpu_supports("popcnt");
+
+        if(avx2 && __builtin_cpu_supports("avx512f")
+            && __builtin_cpu_supports("avx512bw"))
+            return CUHDInstructionSet::AVX512;
+
+        if(avx2) return CUHDInstructionSet::AVX2;
+
+        if(__builtin_cpu_supports("sse4.2")
+            && __builtin_cpu_supports("popcnt"))
+            return CUHDInstructionSet::SSE42;
+        #endif
+
+        return CUHDInstructionSet::GENERIC;
+    }
+
+    CUHDInstructionSet get_default() {
+        const CUHDInstructionSet supported
+            = CUHDDispatch::get_supported_instruction_set();
+
+        const char* env = std::getenv("MULTIANS_ISA");
+        CUHDInstructionSet isa;
+
+        if(env && CUHDDispatch::parse(env, isa))
+            return std::min(isa, supported);
+
+        return supported;
+    }
+
+    std::atomic<CUHDInstructionSet>& selected() {
+        static std::atomic<CUHDInstructionSet> isa(get_default());
+        return isa;
+    }
+}
+
+CUHDInstructionSet CUHDDispatch::get_instruction_set() {
+    return selected().load(std::memory_order_relaxed);
+}
+
+CUHDInstructionSet CUHDDispatch::get_supported_instruction_set() {
+    static const CUHDInstructionSet supported = detect();
+    return supported;
+}
+
+CUHDInstructionSet CUHDDispatch::set_instruction_set(
+    CUHDInstructionSet isa) {
+
+    isa = std::min(isa, get_supported_instruction_set());
+    selected() = isa;
+
+    return isa;
+}
+
+void CUHDDispatch::reset_instruction_set() {
+    selected() = get_default();
+}
+
+const char* CUHDDispatch::get_name(CUHDInstructionSet isa) {
+    switch(isa) {
+        case CUHDInstructionSet::SSE42: return "sse4.2";
+        case CUHDInstructionSet::AVX2: return "avx2";
+        case CUHDInstructionSet::AVX512: return "avx512";
+        default: return "generic";
+    }
+}
+
+bool CUHDDispatch::parse(const char* name, CUHDInstructionSet& isa) {
+    const CUHDInstructionSet all[] = {CUHDInstructionSet::GENERIC,
+        CUHDInstructionSet::SSE42, CUHDInstructionSet::AVX2,
+        CUHDInstructionSet::AVX512};
+
+    for(auto candidate : all) {
+        if(std::strcmp(name, get_name(candidate)) == 0) {
+            isa = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -13,6 +13,33 @@
 #include <thrust/device_ptr.h>
 #include <thrust/scan.h>
 
+// reads the decoder table item of a state index, see CUHDCodetableItem
+__device__ __forceinline__ void read_item(
+    const CUHDCodetableItem* __restrict__ table,
+    std::uint32_t index,
+    STATE_TYPE &next_state,
+    std::uint32_t &taken,
+    SYMBOL_TYPE &symbol) {
+    
+    // 8-bit symbols and 16-bit states, the whole item in a single load
+    if(sizeof(CUHDCodetableItem) == sizeof(uint)) {
+        const uint hit = reinterpret_cast<const uint*>(table)[index];
+        
+        next_state = (std::uint16_t) (hit & 0x0000FFFF);
+        symbol = (hit & ((std::uint32_t) 0x00FF0000)) >> 16;
+        taken = hit >> 24;
+    }
+    
+    // 16-bit symbols (6 bytes) or wide tables (8 bytes)
+    else {
+        const CUHDCodetableItem hit = table[index];
+        
+        next_state = hit.next_state;
+        symbol = hit.symbol;
+        taken = hit.min_num_bits;
+    }
+}
+
 __device__ __forceinline__ void decode_subsequence(
     std::uint32_t subsequence_size,
     std::uint32_t current_subsequence,
@@ -31,7 +58,7 @@ __device__ __forceinline__ void decode_subsequence(
     std::uint32_t &out_pos,
     SYMBOL_TYPE* out_ptr,
     std::uint32_t &next_out_pos,
-    const uint* __restrict__ table,
+    const CUHDCodetableItem* __restrict__ table,
     const std::uint32_t bits_in_unit,
     const std::uint32_t number_of_states,
     std::uint32_t &last_at,
@@ -70,9 +97,11 @@ __device__ __forceinline__ void decode_subsequence(
     if(overflow && current_subsequence > 0 && subsequences_processed == 0) {
 
         // decode first symbol
-        const uint hit_p = table[state - number_of_states];
-        const STATE_TYPE next_state_p = (std::uint16_t) (hit_p & 0x0000FFFF);
-        std::uint32_t taken = hit_p >> 24;
+        STATE_TYPE next_state_p;
+        std::uint32_t taken;
+        SYMBOL_TYPE symbol_p;
+        read_item(table, state - number_of_states,
+            next_state_p, taken, symbol_p);
         
         state = (next_state_p << taken) | (~(mask << taken) & window);
         
@@ -87,7 +116,7 @@ __device__ __forceinline__ void decode_subsequence(
 
             if(write_output) {
                 if(out_pos < next_out_pos) {
-                    out_ptr[out_pos] = (hit_p & ((std::uint32_t) 0x00FF0000)) >> 16;
+                    out_ptr[out_pos] = symbol_p;
                     ++out_pos;
                 }
             }
@@ -130,11 +159,12 @@ __device__ __forceinline__ void decode_subsequence(
 
             last_state = state;
 
-            const uint hit = table[state - number_of_states];
-            
             // decode a symbol
-            const STATE_TYPE next_state = (std::uint16_t) (hit & 0x0000FFFF);
-            std::uint32_t taken = hit >> 24;
+            STATE_TYPE next_state;
+            std::uint32_t taken;
+            SYMBOL_TYPE symbol;
+            read_item(table, state - number_of_states,
+                next_state, taken, symbol);
             
             state = (next_state << taken) | (~(mask << taken) & window);
         
@@ -148,7 +178,7 @@ __device__ __forceinline__ void decode_subsequence(
 
             if(write_output) {
                 if(out_pos < next_out_pos) {
-                    out_ptr[out_pos] = (hit & ((std::uint32_t) 0x00FF0000)) >> 16;
+                    out_ptr[out_pos] = symbol;
                     ++out_pos;
                 }
             }
@@ -197,7 +227,7 @@ __global__ void phase1_decode_subseq(
     std::uint32_t total_num_subsequences,
     std::uint32_t table_size,
     UNIT_TYPE* in_ptr,
-    const uint* __restrict__ table,
+    const CUHDCodetableItem* __restrict__ table,
     uint4* sync_points,
     const std::uint32_t bits_in_unit,
     const std::uint32_t number_of_states,
@@ -218,7 +248,7 @@ __global__ void phase1_decode_subseq(
 
         std::uint32_t out_pos = 0;
         std::uint32_t next_out_pos = 0;
-        std::uint8_t* out_ptr = 0;
+        SYMBOL_TYPE* out_ptr = 0;
         
         // current state
         STATE_TYPE state = initial_state;
@@ -366,9 +396,9 @@ __global__ void phase2_synchronise_blocks(
     std::uint32_t table_size,
     std::uint32_t num_blocks,
     UNIT_TYPE* in_ptr,
-    const uint* __restrict__ table,
+    const CUHDCodetableItem* __restrict__ table,
     uint4* sync_points,
-    SYMBOL_TYPE* block_synchronised,
+    std::uint8_t* block_synchronised,
     const std::uint32_t bits_in_unit,
     const std::uint32_t number_of_states,
     const STATE_TYPE initial_state) {
@@ -386,7 +416,7 @@ __global__ void phase2_synchronise_blocks(
 
         std::uint32_t out_pos = 0;
         std::uint32_t next_out_pos = 0;
-        std::uint8_t* out_ptr = 0;
+        SYMBOL_TYPE* out_ptr = 0;
         
         // jump to first sequence of the block
         std::uint32_t current_subsequence = (gid + 1) * blockDim.x;
@@ -496,7 +526,7 @@ __global__ void phase4_decode_write_output(
     UNIT_TYPE* in_ptr,
     SYMBOL_TYPE* out_ptr,
     std::uint32_t output_size,
-    const uint* __restrict__ table,
+    const CUHDCodetableItem* __restrict__ table,
     const uint4* __restrict__ sync_points,
     const std::uint32_t bits_in_unit,
     const std::uint32_t number_of_states,
@@ -606,7 +636,7 @@ void cuhd::CUHDGPUDecoder::decode(
         num_subseq,
         max_codeword_length,
         in_ptr,
-        reinterpret_cast<uint*>(table_ptr),
+        table_ptr,
         sync_info,
         bits_in_unit,
         number_of_states,
@@ -624,7 +654,7 @@ void cuhd::CUHDGPUDecoder::decode(
                 max_codeword_length,
                 num_sequences,
                 in_ptr,
-                reinterpret_cast<uint*>(table_ptr),
+                table_ptr,
                 sync_info,
                 sequence_synced_device,
                 bits_in_unit,
@@ -677,7 +707,7 @@ void cuhd::CUHDGPUDecoder::decode(
             in_ptr,
             out_ptr,
             output_size,
-            reinterpret_cast<uint*>(table_ptr),
+            table_ptr,
             sync_info,
             bits_in_unit,
             number_of_states,
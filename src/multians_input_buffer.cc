@@ -12,39 +12,76 @@
 
 #include <algorithm>
 
-CUHDInputBuffer::CUHDInputBuffer(UNIT_TYPE* buffer, size_t size,
-    size_t first_bit, size_t first_state)
+template<typename Types>
+CUHDBasicInputBuffer<Types>::CUHDBasicInputBuffer(unit_type* buffer,
+    size_t size, size_t first_bit, size_t first_state,
+    std::shared_ptr<CUHDAllocator> allocator)
     : first_bit_(first_bit),
     first_state_(first_state),
-    compressed_size_(size) {
+    compressed_size_(size),
+    offset_(0) {
       
 	// allocate buffer
 	// avoid invalid read at end of input during decoding
-	buffer_ = std::make_unique<UNIT_TYPE[]>(compressed_size_ + 4);
+	buffer_ = CUHDAllocator::allocate_array<unit_type>(
+	    compressed_size_ + INPUT_BUFFER_PADDING, allocator);
     
 	// pad unused bytes at the end of the buffer with zeroes
-	buffer_.get()[compressed_size_ - 1] = 0;
+	std::fill(buffer_.get() + compressed_size_,
+	    buffer_.get() + compressed_size_ + INPUT_BUFFER_PADDING, 0);
 
 	// copy compressed data into buffer and reverse order of units
 	std::reverse_copy(buffer, buffer + size, buffer_.get());
 }
 
-UNIT_TYPE* CUHDInputBuffer::get_compressed_data() {
-	return buffer_.get();
+template<typename Types>
+CUHDBasicInputBuffer<Types>::CUHDBasicInputBuffer(
+    std::shared_ptr<unit_type[]> buffer,
+    size_t offset, size_t size, size_t first_bit, size_t first_state)
+    : first_bit_(first_bit),
+    first_state_(first_state),
+    compressed_size_(size),
+    buffer_(buffer),
+    offset_(offset) {
+
+}
+
+template<typename Types>
+typename CUHDBasicInputBuffer<Types>::unit_type*
+    CUHDBasicInputBuffer<Types>::get_compressed_data() {
+	return buffer_.get() + offset_;
 }
 
-size_t CUHDInputBuffer::get_first_bit() {
+template<typename Types>
+size_t CUHDBasicInputBuffer<Types>::get_first_bit() {
     return first_bit_;
 }
 
-size_t CUHDInputBuffer::get_first_state() {
+template<typename Types>
+size_t CUHDBasicInputBuffer<Types>::get_first_state() {
     return first_state_;
 }
 
-size_t CUHDInputBuffer::get_compressed_size() {
+template<typename Types>
+size_t CUHDBasicInputBuffer<Types>::get_compressed_size() {
 	return compressed_size_;
 }
 
-size_t CUHDInputBuffer::get_unit_size() {
+template<typename Types>
+size_t CUHDBasicInputBuffer<Types>::get_unit_size() {
 	return unit_size_;	
 }
+
+template<typename Types>
+std::shared_ptr<typename CUHDBasicInputBuffer<Types>::SyncIndex>
+    CUHDBasicInputBuffer<Types>::get_sync_index() {
+	return sync_index_;
+}
+
+template<typename Types>
+void CUHDBasicInputBuffer<Types>::set_sync_index(
+    std::shared_ptr<SyncIndex> index) {
+	sync_index_ = index;
+}
+
+CUHD_INSTANTIATE(CUHDBasicInputBuffer)
@@ -0,0 +1,62 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "cuhd_interleaved_input_buffer.h"
+#include "cuhd_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+template<typename Types>
+CUHDBasicInterleavedInputBuffer<Types>::CUHDBasicInterleavedInputBuffer(
+    std::shared_ptr<InputBuffer> stream, size_t num_states,
+    size_t num_symbols,
+    const std::vector<Checkpoint>& checkpoints)
+    : stream_(stream),
+      num_states_(num_states),
+      num_symbols_(num_symbols),
+      num_checkpoints_(checkpoints.size()) {
+
+    assert(num_states_ > 0 && num_states_ <= MAX_INTERLEAVED_STATES);
+    assert(num_checkpoints_ > 0);
+
+    checkpoints_ = CUHDAllocator::allocate_array<Checkpoint>(
+        num_checkpoints_);
+    std::copy(checkpoints.begin(), checkpoints.end(), checkpoints_.get());
+}
+
+template<typename Types>
+std::shared_ptr<typename CUHDBasicInterleavedInputBuffer<Types>::InputBuffer>
+    CUHDBasicInterleavedInputBuffer<Types>::get_stream() {
+    return stream_;
+}
+
+template<typename Types>
+size_t CUHDBasicInterleavedInputBuffer<Types>::get_num_states() {
+    return num_states_;
+}
+
+template<typename Types>
+size_t CUHDBasicInterleavedInputBuffer<Types>::get_num_symbols() {
+    return num_symbols_;
+}
+
+template<typename Types>
+size_t CUHDBasicInterleavedInputBuffer<Types>::get_num_checkpoints() {
+    return num_checkpoints_;
+}
+
+template<typename Types>
+typename CUHDBasicInterleavedInputBuffer<Types>::Checkpoint*
+    CUHDBasicInterleavedInputBuffer<Types>::get_checkpoints() {
+    return checkpoints_.get();
+}
+
+CUHD_INSTANTIATE(CUHDBasicInterleavedInputBuffer)
@@ -0,0 +1,79 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "cuhd_mapped_file.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CUHDMappedFile::CUHDMappedFile(void* data, size_t size)
+    : data_(data),
+      size_(size) {
+
+}
+
+CUHDMappedFile::~CUHDMappedFile() {
+    if(data_) munmap(data_, size_);
+}
+
+std::shared_ptr<CUHDMappedFile> CUHDMappedFile::open(
+    const std::string& path) {
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return nullptr;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    const size_t size = info.st_size;
+    void* data = nullptr;
+
+    // mmap fails for empty files
+    if(size > 0) {
+        data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if(data == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+    }
+
+    // the mapping stays valid without the descriptor
+    close(fd);
+
+    return std::shared_ptr<CUHDMappedFile>(new CUHDMappedFile(data, size));
+}
+
+const std::uint8_t* CUHDMappedFile::get() {
+    return static_cast<const std::uint8_t*>(data_);
+}
+
+size_t CUHDMappedFile::get_size() {
+    return size_;
+}
+
+void CUHDMappedFile::prefetch(size_t offset, size_t size) {
+    if(!data_ || offset >= size_) return;
+
+    // madvise takes page-aligned addresses
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const size_t begin = offset / page * page;
+    const size_t end = std::min(offset + size, size_);
+
+    madvise(static_cast<std::uint8_t*>(data_) + begin, end - begin,
+        MADV_WILLNEED);
+}
@@ -12,26 +12,50 @@
 
 #include <algorithm>
 
-CUHDOutputBuffer::CUHDOutputBuffer(size_t size) {
+template<typename Types>
+CUHDBasicOutputBuffer<Types>::CUHDBasicOutputBuffer(size_t size,
+    std::shared_ptr<CUHDAllocator> allocator) {
 	uncompressed_size_ = size;
 
-	// allocate buffer
-	buffer_ = std::make_unique<SYMBOL_TYPE[]>(size);
+	// allocate buffer, every symbol is written by the decoders
+	buffer_ = CUHDAllocator::allocate_array<symbol_type>(size, allocator);
 }
 
-std::shared_ptr<SYMBOL_TYPE[]>&
-    CUHDOutputBuffer::get_decompressed_data() {
+template<typename Types>
+CUHDBasicOutputBuffer<Types>::CUHDBasicOutputBuffer(symbol_type* buffer,
+    size_t size) {
+	uncompressed_size_ = size;
+
+	// the caller keeps ownership
+	buffer_ = std::shared_ptr<symbol_type[]>(buffer, [](symbol_type*) {});
+}
+
+template<typename Types>
+CUHDBasicOutputBuffer<Types>::CUHDBasicOutputBuffer(
+    std::shared_ptr<symbol_type[]> buffer, size_t size) {
+	uncompressed_size_ = size;
+	buffer_ = buffer;
+}
+
+template<typename Types>
+std::shared_ptr<typename CUHDBasicOutputBuffer<Types>::symbol_type[]>&
+    CUHDBasicOutputBuffer<Types>::get_decompressed_data() {
 	return buffer_;	
 }
 
-void CUHDOutputBuffer::reverse() {
+template<typename Types>
+void CUHDBasicOutputBuffer<Types>::reverse() {
     std::reverse(buffer_.get(), buffer_.get() + uncompressed_size_);
 }
 
-size_t CUHDOutputBuffer::get_uncompressed_size() {
+template<typename Types>
+size_t CUHDBasicOutputBuffer<Types>::get_uncompressed_size() {
 	return uncompressed_size_;
 }
 
-size_t CUHDOutputBuffer::get_symbol_size() {
+template<typename Types>
+size_t CUHDBasicOutputBuffer<Types>::get_symbol_size() {
 	return symbol_size_;
 }
+
+CUHD_INSTANTIATE(CUHDBasicOutputBuffer)
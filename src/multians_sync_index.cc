@@ -0,0 +1,66 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "cuhd_sync_index.h"
+#include "cuhd_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+template<typename Types>
+CUHDBasicSyncIndex<Types>::CUHDBasicSyncIndex(
+    const std::vector<Checkpoint>& checkpoints, size_t interval,
+    size_t num_symbols)
+    : num_checkpoints_(checkpoints.size()),
+      interval_(interval),
+      num_symbols_(num_symbols) {
+
+    assert(num_checkpoints_ > 0);
+
+    checkpoints_ = CUHDAllocator::allocate_array<Checkpoint>(
+        num_checkpoints_);
+    std::copy(checkpoints.begin(), checkpoints.end(), checkpoints_.get());
+}
+
+template<typename Types>
+size_t CUHDBasicSyncIndex<Types>::get_num_checkpoints() {
+    return num_checkpoints_;
+}
+
+template<typename Types>
+size_t CUHDBasicSyncIndex<Types>::get_num_symbols() {
+    return num_symbols_;
+}
+
+template<typename Types>
+size_t CUHDBasicSyncIndex<Types>::get_interval() {
+    return interval_;
+}
+
+template<typename Types>
+size_t CUHDBasicSyncIndex<Types>::find(size_t output_position) {
+    Checkpoint* begin = checkpoints_.get();
+    Checkpoint* end = begin + num_checkpoints_;
+
+    Checkpoint* it = std::upper_bound(begin, end, output_position,
+        [](size_t pos, const Checkpoint& checkpoint) {
+            return pos < checkpoint.output_offset;});
+
+    // the first checkpoint always has offset 0
+    return (it - begin) - 1;
+}
+
+template<typename Types>
+typename CUHDBasicSyncIndex<Types>::Checkpoint*
+    CUHDBasicSyncIndex<Types>::get() {
+    return checkpoints_.get();
+}
+
+CUHD_INSTANTIATE(CUHDBasicSyncIndex)
@@ -0,0 +1,396 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "cuhd_table_file.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+namespace {
+
+    const char magic[8] = {'M', 'U', 'L', 'T', 'I', 'A', 'N', 'S'};
+
+    size_t align(size_t offset) {
+        return (offset + CUHD_ALLOCATOR_ALIGNMENT - 1)
+            / CUHD_ALLOCATOR_ALIGNMENT * CUHD_ALLOCATOR_ALIGNMENT;
+    }
+
+    // header of the given configuration and contents, without sections
+    template<typename Types>
+    CUHDTableFileHeader get_header(std::uint32_t contents) {
+        CUHDTableFileHeader header;
+        std::memset(&header, 0, sizeof(CUHDTableFileHeader));
+
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = CUHD_TABLE_FILE_VERSION;
+        header.contents = contents;
+
+        header.unit_size = sizeof(typename Types::unit_type);
+        header.state_size = sizeof(typename Types::state_type);
+        header.symbol_size = sizeof(typename Types::symbol_type);
+        header.table_state_size = sizeof(typename Types::table_state_type);
+        header.item_size = sizeof(CUHDBasicCodetableItem<Types>);
+
+        return header;
+    }
+
+    // appends sections of the given size at aligned offsets
+    struct Layout {
+        size_t size;
+
+        std::uint64_t add(size_t bytes) {
+            if(bytes == 0) return 0;
+
+            const size_t offset = align(size);
+            size = offset + bytes;
+
+            return offset;
+        }
+    };
+
+    // writes the header and the sections in the order of their offsets
+    bool write_file(const std::string& path,
+        const CUHDTableFileHeader& header,
+        const std::vector<std::pair<std::uint64_t, std::pair<const void*,
+            size_t>>>& sections) {
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out) return false;
+
+        out.write(reinterpret_cast<const char*>(&header),
+            sizeof(CUHDTableFileHeader));
+
+        size_t at = sizeof(CUHDTableFileHeader);
+        const char zero[CUHD_ALLOCATOR_ALIGNMENT] = {0};
+
+        for(auto& section : sections) {
+            if(section.first == 0) continue;
+
+            out.write(zero, section.first - at);
+            out.write(static_cast<const char*>(section.second.first),
+                section.second.second);
+
+            at = section.first + section.second.second;
+        }
+
+        return (bool) out.flush();
+    }
+
+    // packed tables are used in place, so each item must be the one
+    // ANSTableGenerator builds: a symbol of the table, a sub-state in
+    // [L_s, 2 * L_s) of its symbol, used once, and the number of bits that
+    // brings it back into [num_states, 2 * num_states)
+    // the transforms and next states of the encoder must match the items
+    template<typename Types>
+    bool is_valid_packed(const CUHDBasicCodetableItem<Types>* items,
+        const typename ANSBasicEncoderTable<Types>::ANSSymbolTransform*
+            transforms,
+        const std::uint32_t* next_states,
+        size_t num_states, size_t num_symbols) {
+
+        std::vector<size_t> L_s(num_symbols, 0);
+
+        for(size_t i = 0; i < num_states; ++i) {
+            if(items[i].symbol >= num_symbols) return false;
+            ++L_s[items[i].symbol];
+        }
+
+        // index of the first next state of each symbol
+        std::vector<size_t> first(num_symbols, 0);
+        size_t start = 0;
+        size_t num_used = 0;
+
+        for(size_t i = 0; i < num_symbols; ++i) {
+            const std::uint64_t num = L_s[i];
+            std::uint64_t delta_num_bits = 0;
+            std::int32_t delta_find_state = 0;
+
+            if(num > 0) {
+                std::uint64_t max_bits = 0;
+                while(((2 * num_states - 1) >> max_bits) >= 2 * num)
+                    ++max_bits;
+
+                delta_num_bits = (max_bits << 32) - (num << max_bits);
+                delta_find_state = (std::int32_t) start - (std::int32_t) num;
+
+                first[i] = start;
+                start += num;
+                ++num_used;
+            }
+
+            if(transforms[i].num_states != num
+                || transforms[i].delta_num_bits != delta_num_bits
+                || transforms[i].delta_find_state != delta_find_state)
+                return false;
+        }
+
+        // a single symbol only has 0-bit codewords
+        if(num_used < 2) return false;
+
+        std::vector<bool> seen(num_states, false);
+
+        for(size_t i = 0; i < num_states; ++i) {
+            const size_t symbol = items[i].symbol;
+            const size_t next_state = items[i].next_state;
+
+            if(next_state < L_s[symbol] || next_state >= 2 * L_s[symbol])
+                return false;
+
+            size_t len = 0;
+            while((next_state << len) < num_states) ++len;
+
+            if(items[i].min_num_bits != len) return false;
+
+            const size_t index = first[symbol] + next_state - L_s[symbol];
+
+            if(seen[index] || next_states[index] != num_states + i)
+                return false;
+
+            seen[index] = true;
+        }
+
+        return true;
+    }
+}
+
+template<typename Types>
+CUHDBasicTableFile<Types>::CUHDBasicTableFile(
+    std::shared_ptr<CUHDMappedFile> file)
+    : file_(file),
+      header_(nullptr) {
+
+}
+
+template<typename Types>
+bool CUHDBasicTableFile<Types>::write(const std::string& path,
+    std::shared_ptr<EncoderTable> encoder_table,
+    std::shared_ptr<Codetable> decoder_table) {
+
+    typedef typename Codetable::Item Item;
+    typedef typename EncoderTable::ANSSymbolTransform Transform;
+
+    const size_t num_states = encoder_table->number_of_states;
+    const size_t num_symbols = encoder_table->number_of_symbols;
+
+    const size_t items_size = num_states * sizeof(Item);
+    const size_t transforms_size = num_symbols * sizeof(Transform);
+    const size_t next_states_size = num_states * sizeof(std::uint32_t);
+
+    assert(decoder_table->get_num_entries() == num_states);
+
+    CUHDTableFileHeader header = get_header<Types>(CUHD_TABLE_FILE_PACKED);
+    header.num_states = num_states;
+    header.num_symbols = num_symbols;
+
+    Layout layout = {sizeof(CUHDTableFileHeader)};
+    header.items = layout.add(items_size);
+    header.transforms = layout.add(transforms_size);
+    header.next_states = layout.add(next_states_size);
+    header.file_size = layout.size;
+
+    return write_file(path, header, {
+        {header.items, {decoder_table->get(), items_size}},
+        {header.transforms,
+            {encoder_table->transform.data(), transforms_size}},
+        {header.next_states,
+            {encoder_table->next_state.data(), next_states_size}}});
+}
+
+template<typename Types>
+bool CUHDBasicTableFile<Types>::write(const std::string& path,
+    std::shared_ptr<std::vector<size_t>> counts,
+    std::shared_ptr<std::vector<symbol_type>> symbols) {
+
+    const size_t num_symbols = counts->size();
+
+    std::vector<std::uint32_t> symbols_out(num_symbols);
+    std::vector<std::uint32_t> counts_out(counts->begin(), counts->end());
+
+    for(size_t i = 0; i < num_symbols; ++i)
+        symbols_out[i] = symbols == nullptr ? i : symbols->at(i);
+
+    const size_t size = num_symbols * sizeof(std::uint32_t);
+
+    CUHDTableFileHeader header = get_header<Types>(CUHD_TABLE_FILE_COUNTS);
+    header.num_states = std::accumulate(counts->begin(), counts->end(),
+        (size_t) 0);
+    header.num_symbols = num_symbols;
+
+    Layout layout = {sizeof(CUHDTableFileHeader)};
+    header.symbols = layout.add(size);
+    header.counts = layout.add(size);
+    header.file_size = layout.size;
+
+    return write_file(path, header, {
+        {header.symbols, {symbols_out.data(), size}},
+        {header.counts, {counts_out.data(), size}}});
+}
+
+template<typename Types>
+std::shared_ptr<CUHDBasicTableFile<Types>> CUHDBasicTableFile<Types>::open(
+    const std::string& path) {
+
+    std::shared_ptr<CUHDMappedFile> file = CUHDMappedFile::open(path);
+    if(!file) return nullptr;
+
+    std::shared_ptr<CUHDBasicTableFile> table_file(
+        new CUHDBasicTableFile(file));
+
+    if(!table_file->load()) return nullptr;
+
+    return table_file;
+}
+
+template<typename Types>
+bool CUHDBasicTableFile<Types>::load() {
+    typedef typename Codetable::Item Item;
+    typedef typename EncoderTable::ANSSymbolTransform Transform;
+
+    const size_t file_size = file_->get_size();
+    if(file_size < sizeof(CUHDTableFileHeader)) return false;
+
+    header_ = reinterpret_cast<const CUHDTableFileHeader*>(file_->get());
+
+    CUHDTableFileHeader expected = get_header<Types>(header_->contents);
+
+    if(std::memcmp(header_->magic, magic, sizeof(magic)) != 0
+        || header_->version != CUHD_TABLE_FILE_VERSION
+        || header_->unit_size != expected.unit_size
+        || header_->state_size != expected.state_size
+        || header_->symbol_size != expected.symbol_size
+        || header_->table_state_size != expected.table_state_size
+        || header_->item_size != expected.item_size
+        || header_->file_size != file_size) return false;
+
+    const size_t num_states = header_->num_states;
+    const size_t num_symbols = header_->num_symbols;
+
+    // tANS tables have a power of two states, a single symbol only has
+    // 0-bit codewords
+    if(num_states == 0 || num_states > Types::max_num_states
+        || (num_states & (num_states - 1)) != 0
+        || num_symbols < 2 || num_symbols > num_states) return false;
+
+    // a section must lie within the file
+    auto fits = [&](std::uint64_t offset, size_t size) {
+        return offset >= sizeof(CUHDTableFileHeader)
+            && offset % CUHD_ALLOCATOR_ALIGNMENT == 0
+            && offset <= file_size && size <= file_size - offset;
+    };
+
+    const std::uint8_t* data = file_->get();
+
+    if(header_->contents == CUHD_TABLE_FILE_COUNTS) {
+        const size_t size = num_symbols * sizeof(std::uint32_t);
+
+        if(!fits(header_->symbols, size) || !fits(header_->counts, size))
+            return false;
+
+        const std::uint32_t* symbols = reinterpret_cast<const std::uint32_t*>(
+            data + header_->symbols);
+        const std::uint32_t* counts = reinterpret_cast<const std::uint32_t*>(
+            data + header_->counts);
+
+        auto prob = std::make_shared<std::vector<double>>(num_symbols);
+        auto dist = std::make_shared<std::vector<size_t>>(num_symbols);
+        auto syms = std::make_shared<std::vector<symbol_type>>(num_symbols);
+
+        size_t sum = 0;
+
+        for(size_t i = 0; i < num_symbols; ++i) {
+            if(counts[i] == 0 || symbols[i] >= ((size_t) 1
+                << (sizeof(symbol_type) * 8))) return false;
+
+            (*prob)[i] = (double) counts[i] / num_states;
+            (*dist)[i] = counts[i];
+            (*syms)[i] = symbols[i];
+
+            sum += counts[i];
+        }
+
+        if(sum != num_states) return false;
+
+        encoder_table_ = Generator::generate_encoder_table(
+            Generator::generate_table(prob, dist, syms, num_symbols,
+                num_states));
+        decoder_table_ = Generator::get_decoder_table(encoder_table_);
+
+        return true;
+    }
+
+    if(header_->contents != CUHD_TABLE_FILE_PACKED) return false;
+
+    if(!fits(header_->items, num_states * sizeof(Item))
+        || !fits(header_->transforms, num_symbols * sizeof(Transform))
+        || !fits(header_->next_states, num_states * sizeof(std::uint32_t)))
+        return false;
+
+    if(!is_valid_packed<Types>(
+        reinterpret_cast<const Item*>(data + header_->items),
+        reinterpret_cast<const Transform*>(data + header_->transforms),
+        reinterpret_cast<const std::uint32_t*>(data + header_->next_states),
+        num_states, num_symbols)) return false;
+
+    // the items point into the mapping and keep it alive, the decoders
+    // only read them
+    std::shared_ptr<Item[]> items(file_, const_cast<Item*>(
+        reinterpret_cast<const Item*>(data + header_->items)));
+
+    decoder_table_ = std::make_shared<Codetable>(items, num_states);
+
+    return true;
+}
+
+template<typename Types>
+std::uint32_t CUHDBasicTableFile<Types>::get_contents() {
+    return header_->contents;
+}
+
+template<typename Types>
+size_t CUHDBasicTableFile<Types>::get_num_states() {
+    return header_->num_states;
+}
+
+template<typename Types>
+std::shared_ptr<typename CUHDBasicTableFile<Types>::Codetable>
+    CUHDBasicTableFile<Types>::get_decoder_table() {
+    return decoder_table_;
+}
+
+template<typename Types>
+std::shared_ptr<typename CUHDBasicTableFile<Types>::EncoderTable>
+    CUHDBasicTableFile<Types>::get_encoder_table() {
+
+    if(encoder_table_) return encoder_table_;
+
+    typedef typename EncoderTable::ANSSymbolTransform Transform;
+
+    const std::uint8_t* data = file_->get();
+    const size_t num_states = header_->num_states;
+    const size_t num_symbols = header_->num_symbols;
+
+    const Transform* transforms = reinterpret_cast<const Transform*>(
+        data + header_->transforms);
+    const std::uint32_t* next_states = reinterpret_cast<const std::uint32_t*>(
+        data + header_->next_states);
+
+    std::shared_ptr<EncoderTable> table = std::make_shared<EncoderTable>();
+    table->max_number_of_symbols = (size_t) 1 << (sizeof(symbol_type) * 8);
+    table->number_of_symbols = num_symbols;
+    table->number_of_states = num_states;
+    table->transform.assign(transforms, transforms + num_symbols);
+    table->next_state.assign(next_states, next_states + num_states);
+
+    return table;
+}
+
+CUHD_INSTANTIATE(CUHDBasicTableFile)
@@ -62,7 +62,8 @@ std::pair<std::string, size_t> cuhd::CUHDUtil::time(std::string s,
     return p;
 }
 
-bool cuhd::CUHDUtil::equals(SYMBOL_TYPE* a, SYMBOL_TYPE* b, size_t size) {
+template<typename SYMBOL>
+bool cuhd::CUHDUtil::equals(SYMBOL* a, SYMBOL* b, size_t size) {
     for(size_t i = 0; i < size; ++i) {
         if(a[i] != b[i]) {
         std::cout << "mismatch at: " << i << std::endl;
@@ -71,6 +72,9 @@ bool cuhd::CUHDUtil::equals(SYMBOL_TYPE* a, SYMBOL_TYPE* b, size_t size) {
     return true;
 }
 
+template bool cuhd::CUHDUtil::equals(std::uint8_t*, std::uint8_t*, size_t);
+template bool cuhd::CUHDUtil::equals(std::uint16_t*, std::uint16_t*, size_t);
+
 size_t cuhd::CUHDUtil::optimal_subsequence_size(size_t input_size, 
     size_t output_size, size_t pref, size_t device_pref) {
     
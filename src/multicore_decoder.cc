@@ -9,273 +9,519 @@
  *****************************************************************************/
 
 #include "multicore_decoder.h"
+#include "multicore_decoder_session.h"
+#include "cuhd_bit_io.h"
 
+#include <algorithm>
 #include <memory>
 #include <cassert>
-#include <thread>
 
-void MulticoreDecoder::decode(
-    size_t subsequence_size,
-    size_t num_threads,
-    size_t input_size_units,
-    std::shared_ptr<CUHDOutputBuffer> out,
-    std::shared_ptr<CUHDInputBuffer> in,
-    std::shared_ptr<CUHDCodetable> tab) {
-    
-    // split units into subsequences
-    size_t num_subsequences = input_size_units / subsequence_size;
-    size_t num_remaining = input_size_units % subsequence_size;
-    if(num_remaining != 0) ++num_subsequences;
-    
-    // spread subsequences over multiple threads
-    std::vector<DecoderInterval> intervals = get_decoder_intervals(
-        subsequence_size, num_threads, input_size_units);
-    
-    // create array to track synchronization points
-    std::shared_ptr<SubsequenceSyncPoint[]> sync_info(
-        new SubsequenceSyncPoint[num_subsequences]);
-    
-    std::vector<std::thread> threads(num_threads);
-    std::shared_ptr<std::vector<size_t>> thread_synced(
-        new std::vector<size_t>(num_threads, false));
-    std::shared_ptr<size_t[]> out_positions(new size_t[num_threads]);
-    
-    for(size_t i = 0; i < num_threads; ++i) {
-        threads[i] = std::thread(decode_phase1, i,
-            intervals.at(i).begin, intervals.at(i).end, intervals.at(i).sub,
-            subsequence_size, input_size_units, num_threads,
-            out_positions, out, in, tab, sync_info, thread_synced,
-            false, false);
-    }
-    
-    for(size_t i = 0; i < num_threads; ++i) {
-        threads[i].join();
-    }
-    
-    bool synchronized = false;
-    
-    while(!synchronized) {
-        for(size_t i = 1; i < num_threads; ++i) {
-            threads[i] = std::thread(decode_phase1, i,
-                intervals.at(i).begin, intervals.at(i).end, intervals.at(i).sub,
-                subsequence_size, input_size_units, num_threads,
-                out_positions, out, in, tab, sync_info, thread_synced,
-                true, false);
+namespace {
+
+    using cuhd::load_window;
+
+    // body of MulticoreDecoder::decode_phase1
+    template<typename Types>
+    CUHD_FORCE_INLINE void phase1_kernel(
+        size_t thread_id,
+        size_t begin,
+        size_t end,
+        size_t subsequence,
+        size_t subsequence_size,
+        size_t num_units,
+        size_t num_threads,
+        std::shared_ptr<size_t[]> out_positions,
+        std::shared_ptr<CUHDBasicOutputBuffer<Types>> out,
+        std::shared_ptr<CUHDBasicInputBuffer<Types>> in,
+        std::shared_ptr<CUHDBasicCodetable<Types>> tab,
+        std::shared_ptr<typename MulticoreBasicDecoder<Types>::
+            SubsequenceSyncPoint[]> sync_info,
+        std::shared_ptr<std::vector<size_t>> thread_synced,
+        bool overflow,
+        bool write,
+        typename MulticoreBasicDecoder<Types>::SpeculativeOutput* speculative,
+        bool forward,
+        const typename MulticoreBasicDecoder<Types>::SubsequenceSyncPoint*
+            start) {
+
+        typedef typename Types::unit_type unit_type;
+        typedef typename Types::state_type state_type;
+        typedef typename Types::symbol_type symbol_type;
+        typedef typename MulticoreBasicDecoder<Types>::SubsequenceSyncPoint
+            SubsequenceSyncPoint;
+
+        if(overflow) {
+            if(thread_synced->at(thread_id) == true) return;
         }
         
-        for(size_t i = 1; i < num_threads; ++i) {
-            threads[i].join();
+        // only the write pass touches the output, which is not known yet
+        // when a stream window is synchronised
+        symbol_type* out_ptr = write ? out->get_decompressed_data().get()
+            : nullptr;
+        const size_t size_out = write ? out->get_uncompressed_size() : 0;
+        
+        // the symbol at out_pos goes to out_base[out_step * out_pos], in
+        // forward order the output positions are mirrored
+        symbol_type* out_base = forward && write ? out_ptr + size_out - 1
+            : out_ptr;
+        const std::ptrdiff_t out_step = forward ? -1 : 1;
+        
+        unit_type* in_ptr = in->get_compressed_data();
+        
+        const CUHDBasicCodetableItem<Types>* table = tab->get();
+        
+        SubsequenceSyncPoint* sync = sync_info.get();
+        
+        const size_t number_of_states = tab->get_num_entries();
+        const size_t bits_in_unit = in->get_unit_size() * 8;
+
+        state_type current_state = in->get_first_state();
+        
+        std::uint8_t at = (thread_id == 0) ? bits_in_unit - in->get_first_bit()
+            : 0;
+        
+        size_t in_pos = begin;
+        size_t out_pos = 0;
+        size_t out_size = 0;
+        size_t current_subsequence = subsequence;
+        std::uint32_t current_unit = 0;
+        
+        if(overflow || (write && thread_id > 0)) {
+            const SubsequenceSyncPoint sp = start ? *start
+                : sync[current_subsequence - 1];
+            current_state = sp.state;
+            at = sp.bit;
+            in_pos -= subsequence_size;
+            in_pos += sp.unit;
+            current_unit = sp.unit;
         }
         
-        synchronized = true;
+        if(write) {
+            SubsequenceSyncPoint sp = sync[current_subsequence];
+            out_pos = out_positions.get()[thread_id];
+            
+            if(thread_id < num_threads - 1) {
+                sp = sync[current_subsequence + 1];
+                out_size = out_positions.get()[thread_id + 1];
+            }
+            
+            else out_size = size_out;
+        }
+        
+        // phase 1 keeps a copy of its symbols for the write pass
+        symbol_type* scratch_ptr = nullptr;
+        size_t scratch_capacity = 0;
+        size_t scratch_pos = 0;
         
-        for(size_t i = 1; i < num_threads; ++i) {
-            if(!thread_synced->at(i)) synchronized = false;
+        if(speculative && !overflow && !write) {
+            scratch_ptr = speculative->symbols.get();
+            scratch_capacity = speculative->capacity;
+            speculative->num_invalid = 0;
+            speculative->valid = true;
         }
-    }
-    
-    prefix_sum(sync_info, out_positions, num_subsequences, num_threads);
-    
-    for(size_t i = 0; i < num_threads; ++i) {
-        threads[i] = std::thread(decode_phase1, i,
-            intervals.at(i).begin, intervals.at(i).end, intervals.at(i).sub,
-            subsequence_size, input_size_units, num_threads,
-            out_positions, out, in, tab, sync_info, thread_synced,
-            false, true);
-    }
-    
-    for(size_t i = 0; i < num_threads; ++i) {
-        threads[i].join();
-    }
-}
-
-void MulticoreDecoder::decode_phase1(
-    size_t thread_id,
-    size_t begin,
-    size_t end,
-    size_t subsequence,
-    size_t subsequence_size,
-    size_t num_units,
-    size_t num_threads,
-    std::shared_ptr<size_t[]> out_positions,
-    std::shared_ptr<CUHDOutputBuffer> out,
-    std::shared_ptr<CUHDInputBuffer> in,
-    std::shared_ptr<CUHDCodetable> tab,
-    std::shared_ptr<SubsequenceSyncPoint[]> sync_info,
-    std::shared_ptr<std::vector<size_t>> thread_synced,
-    bool overflow,
-    bool write) {
-
-    if(overflow) {
-        if(thread_synced->at(thread_id) == true) return;
-    }
-    
-    SYMBOL_TYPE* out_ptr = out->get_decompressed_data().get();
-    const size_t size_out = out->get_uncompressed_size();
-    
-    UNIT_TYPE* in_ptr = in->get_compressed_data();
-    
-    const CUHDCodetableItem* table = tab->get();
-    
-    SubsequenceSyncPoint* sync = sync_info.get();
-    
-    const size_t number_of_states = tab->get_num_entries();
-    const size_t bits_in_unit = in->get_unit_size() * 8;
-
-    UNIT_TYPE current_state = in->get_first_state();
-    
-    std::uint8_t at = (thread_id == 0) ? bits_in_unit - in->get_first_bit()
-        : 0;
-    
-    size_t in_pos = begin;
-    size_t out_pos = 0;
-    size_t out_size = 0;
-    size_t current_subsequence = subsequence;
-    std::uint32_t current_unit = 0;
-    
-    if(overflow || (write && thread_id > 0)) {
-        SubsequenceSyncPoint sp = sync[current_subsequence - 1];
-        current_state = sp.state;
-        at = sp.bit;
-        in_pos -= subsequence_size;
-        in_pos += sp.unit;
-        current_unit = sp.unit;
-    }
-    
-    if(write) {
-        SubsequenceSyncPoint sp = sync[current_subsequence];
-        out_pos = out_positions.get()[thread_id];
         
-        if(thread_id < num_threads - 1) {
-            sp = sync[current_subsequence + 1];
-            out_size = out_positions.get()[thread_id + 1];
+        // the last subsequence may be partial, nothing behind the stream
+        // is decoded
+        end = std::min(end, num_units);
+        
+        // only the invalid subsequences are decoded again, the rest is copied
+        const bool copy_tail = write && speculative && speculative->valid;
+        
+        if(copy_tail) {
+            end = std::min(end, begin
+                + speculative->num_invalid * subsequence_size);
         }
         
-        else out_size = size_out;
-    }
-    
-    UNIT_TYPE window = in_ptr[in_pos];
-    UNIT_TYPE next = in_ptr[in_pos + 1];
-    const UNIT_TYPE mask = (UNIT_TYPE) (0) - 1;
+        // the current and the next unit, shifted to the start
+        typename Types::window_type window
+            = load_window<Types>(in_ptr + in_pos) >> at;
+        const unit_type mask = (unit_type) (0) - 1;
 
-    UNIT_TYPE last_state = 0;
-    std::uint32_t last_bit = 0;
-    bool reset = false;
-    if(write && thread_id == 0) reset = true;
-    
-    // shift to start
-    UNIT_TYPE copy_next = next;
-    copy_next <<= bits_in_unit - at;
-
-    next >>= at;
-    window >>= at;
-    window += copy_next;
-    
-    std::uint32_t num_symbols = 0;
-    
-    while(in_pos < end) {
-        while(at < bits_in_unit) {
+        state_type last_state = 0;
+        std::uint32_t last_bit = 0;
+        bool reset = false;
+        if(write && thread_id == 0) reset = true;
+        
+        std::uint32_t num_symbols = 0;
         
-            last_state = current_state;
+        while(in_pos < end) {
+            while(at < bits_in_unit) {
+                last_state = current_state;
 
-            const CUHDCodetableItem hit
-                = table[current_state - number_of_states];
-            
-            const STATE_TYPE next_state = hit.next_state;
-            
-            // decode a symbol
-            size_t taken = hit.min_num_bits;
-            ++num_symbols;
-            
-            UNIT_TYPE reversed = ~(mask << taken) & window;
-            current_state = (next_state << taken) + reversed;
-            
-            while(current_state < number_of_states) {
-                const UNIT_TYPE shift = window >> taken;
-                ++taken;
-                current_state = (current_state << 1) + (~(mask << 1) & shift);
-            }
+                const CUHDBasicCodetableItem<Types> hit
+                    = table[current_state - number_of_states];
+                
+                const state_type next_state = hit.next_state;
+                
+                // decode a symbol
+                size_t taken = hit.min_num_bits;
+                ++num_symbols;
+                
+                unit_type reversed = ~(mask << taken) & window;
+                current_state = (next_state << taken) + reversed;
+                
+                while(current_state < number_of_states) {
+                    const unit_type shift = window >> taken;
+                    ++taken;
+                    current_state = (current_state << 1) + (~(mask << 1) & shift);
+                }
 
-            if(write && reset && out_pos < out_size) {
-                out_ptr[out_pos] = hit.symbol;
-                ++out_pos;
-            }
-            
-            if(taken > 0) {
-                copy_next = next;
-                copy_next <<= bits_in_unit - taken;
+                if(write && reset && out_pos < out_size) {
+                    out_base[out_step * (std::ptrdiff_t) out_pos] = hit.symbol;
+                    ++out_pos;
+                }
+                
+                if(scratch_pos < scratch_capacity)
+                    scratch_ptr[scratch_pos] = hit.symbol;
+                ++scratch_pos;
+                
+                last_bit = at;
+                
+                window >>= taken;
+                at += taken;
             }
             
-            else copy_next = 0;
+            ++in_pos;
+            ++current_unit;
             
-            last_bit = at;
+            if(current_unit == subsequence_size) {
+                if(overflow && reset) {
+                    SubsequenceSyncPoint sp = sync[current_subsequence];
+                    
+                    if(sp.state == last_state
+                        && sp.bit == last_bit
+                        && sp.unit == current_unit - 1) {
+
+                        sync[current_subsequence].num_symbols = num_symbols;
+                        thread_synced->at(thread_id) = true;
+                        
+                        if(speculative) {
+                            speculative->num_invalid = std::max(
+                                speculative->num_invalid,
+                                current_subsequence - subsequence + 1);
+                        }
 
-            next >>= taken;
-            window >>= taken;
-            at += taken;
-            window += copy_next;
+                        return;
+                    }
+                }
+
+                if(!overflow || reset) {
+                    if(!write) {
+                        sync[current_subsequence] = {last_state, last_bit,
+                            current_unit - 1, num_symbols};
+                    }    
+                    
+                    ++current_subsequence;
+                }
+                
+                reset = true;
+                
+                current_unit = 0;
+                num_symbols = 0;
+            }
+            
+            // refill, skipping the bits already taken from the next unit
+            at -= bits_in_unit;
+            window = load_window<Types>(in_ptr + in_pos) >> at;
         }
         
-        // refill decoder window if necessary
-        ++in_pos;
-        ++current_unit;
+        const bool at_stream_end = in_pos >= num_units;
         
-        if(current_unit == subsequence_size) {
-            if(overflow && reset) {
-                SubsequenceSyncPoint sp = sync[current_subsequence];
+        // the last interval has no successor relying on its sync points
+        if(overflow && at_stream_end) thread_synced->at(thread_id) = true;
+        
+        // the encoder starts at state N and emits no bits for its first
+        // symbols unless it renormalises, the last symbols of the stream
+        // are then decoded from 0-bit codewords behind the last unit
+        if(write && reset && at_stream_end) {
+            while(out_pos < out_size) {
+                const CUHDBasicCodetableItem<Types> hit
+                    = table[current_state - number_of_states];
+                
+                out_base[out_step * (std::ptrdiff_t) out_pos] = hit.symbol;
+                ++out_pos;
                 
-                if(sp.state == last_state
-                    && sp.bit == last_bit
-                    && sp.unit == current_unit - 1) {
+                // the padding behind the stream is zero
+                current_state = (state_type) hit.next_state
+                    << hit.min_num_bits;
+            }
+        }
+        
+        // phase 1 does not know the size of the output, the decoder
+        // returns to state N after the first symbol
+        if(scratch_ptr && at_stream_end) {
+            while(current_state != number_of_states) {
+                const CUHDBasicCodetableItem<Types> hit
+                    = table[current_state - number_of_states];
+                
+                // 0-bit codewords lower the state, this ends within N steps
+                if(hit.min_num_bits > 0) break;
+                
+                if(scratch_pos < scratch_capacity)
+                    scratch_ptr[scratch_pos] = hit.symbol;
+                ++scratch_pos;
+                
+                current_state = hit.next_state;
+            }
+        }
 
-                    sync[current_subsequence].num_symbols = num_symbols;
-                    thread_synced->at(thread_id) = true;
+        if(speculative && !write) {
 
-                    return;
-                }
-            }
+            // no sync point found, the whole interval has been rewritten
+            if(overflow) speculative->valid = false;
 
-            if(!overflow || reset) {
-                if(!write) {
-                    sync[current_subsequence] = {last_state, last_bit,
-                        current_unit - 1, num_symbols};
-                }    
-                
-                ++current_subsequence;
+            else {
+                speculative->size = scratch_pos;
+                if(scratch_pos > scratch_capacity) speculative->valid = false;
             }
+        }
+        
+        if(copy_tail) {
+        
+            // the symbols behind the invalid subsequences end the scratch
+            const size_t num_copy = std::min(out_size - out_pos,
+                speculative->size);
             
-            if(overflow && in_pos > num_units)
-                thread_synced->at(thread_id) = true;
+            const symbol_type* scratch = speculative->symbols.get()
+                + speculative->size - num_copy;
             
-            reset = true;
+            if(forward) {
+                std::reverse_copy(scratch, scratch + num_copy,
+                    out_ptr + size_out - out_pos - num_copy);
+            }
             
-            current_unit = 0;
-            num_symbols = 0;
+            else std::copy(scratch, scratch + num_copy, out_ptr + out_pos);
         }
+    }
+
+    // body of MulticoreDecoder::decode_checkpoint
+    template<typename Types>
+    CUHD_FORCE_INLINE void checkpoint_kernel(
+        const CUHDBasicSyncCheckpoint<Types>& checkpoint,
+        size_t skip,
+        size_t num_symbols,
+        typename Types::symbol_type* out,
+        std::shared_ptr<CUHDBasicInputBuffer<Types>> in,
+        std::shared_ptr<CUHDBasicCodetable<Types>> tab,
+        bool forward) {
         
-        window = in_ptr[in_pos];
-        next = in_ptr[in_pos + 1];
+        typedef typename Types::unit_type unit_type;
+        typedef typename Types::state_type state_type;
+        typedef typename Types::symbol_type symbol_type;
         
-        if(at == bits_in_unit) {
-            at = 0;
-        }
-
-        else {
-            at -= bits_in_unit;
-            window >>= at;
-            next >>= at;
+        if(num_symbols == 0) return;
+        
+        // symbols are written to out_base[out_step * (out_pos - skip)]
+        symbol_type* out_base = forward ? out + num_symbols - 1 : out;
+        const std::ptrdiff_t out_step = forward ? -1 : 1;
+        
+        num_symbols += skip;
+        
+        unit_type* in_ptr = in->get_compressed_data();
+        
+        const CUHDBasicCodetableItem<Types>* table = tab->get();
+        
+        const size_t number_of_states = tab->get_num_entries();
+        const size_t bits_in_unit = in->get_unit_size() * 8;
+        
+        state_type current_state = checkpoint.state;
+        std::uint32_t at = checkpoint.bit;
+        size_t in_pos = checkpoint.unit;
+        size_t out_pos = 0;
+        
+        // the current and the next unit, shifted to the start
+        typename Types::window_type window
+            = load_window<Types>(in_ptr + in_pos) >> at;
+        const unit_type mask = (unit_type) (0) - 1;
+        
+        while(true) {
+            while(at < bits_in_unit) {
+                const CUHDBasicCodetableItem<Types> hit
+                    = table[current_state - number_of_states];
+                
+                const state_type next_state = hit.next_state;
+                
+                // decode a symbol
+                size_t taken = hit.min_num_bits;
+                
+                unit_type reversed = ~(mask << taken) & window;
+                current_state = (next_state << taken) + reversed;
+                
+                while(current_state < number_of_states) {
+                    const unit_type shift = window >> taken;
+                    ++taken;
+                    current_state = (current_state << 1) + (~(mask << 1) & shift);
+                }
+                
+                if(out_pos >= skip) {
+                    out_base[out_step * (std::ptrdiff_t) (out_pos - skip)]
+                        = hit.symbol;
+                }
+                if(++out_pos == num_symbols) return;
+                
+                window >>= taken;
+                at += taken;
+            }
             
-            UNIT_TYPE copy_next = in_ptr[in_pos + 1];
-            copy_next <<= bits_in_unit - at;
-            window += copy_next;
+            // refill, skipping the bits already taken from the next unit
+            ++in_pos;
+            at -= bits_in_unit;
+            window = load_window<Types>(in_ptr + in_pos) >> at;
         }
     }
+
+    // kernel variants, see CUHDDispatch
+    template<typename... Args>
+    void phase1_generic(Args... args) {
+        phase1_kernel(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_SSE42 void phase1_sse42(Args... args) {
+        phase1_kernel(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_AVX2 void phase1_avx2(Args... args) {
+        phase1_kernel(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_AVX512 void phase1_avx512(Args... args) {
+        phase1_kernel(args...);
+    }
+    
+    template<typename... Args>
+    void checkpoint_generic(Args... args) {
+        checkpoint_kernel(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_SSE42 void checkpoint_sse42(Args... args) {
+        checkpoint_kernel(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_AVX2 void checkpoint_avx2(Args... args) {
+        checkpoint_kernel(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_AVX512 void checkpoint_avx512(Args... args) {
+        checkpoint_kernel(args...);
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoder<Types>::decode(
+    size_t subsequence_size,
+    size_t num_threads,
+    size_t input_size_units,
+    std::shared_ptr<OutputBuffer> out,
+    std::shared_ptr<InputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    MulticoreDecoderOptions options) {
+    
+    // one-shot session, threads are created once for all passes
+    MulticoreBasicDecoderSession<Types> session(num_threads, options);
+    session.decode(subsequence_size, input_size_units, out, in, tab);
+}
+
+template<typename Types>
+void MulticoreBasicDecoder<Types>::decode_range(
+    std::shared_ptr<InputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    size_t begin_symbol,
+    size_t count,
+    symbol_type* out) {
+    
+    std::shared_ptr<SyncIndex> index = in->get_sync_index();
+    assert(index);
+    
+    const size_t num_symbols = index->get_num_symbols();
+    assert(begin_symbol + count <= num_symbols);
+    
+    if(count == 0) return;
+    
+    // the decoder produces the symbols in reverse order
+    const size_t first = num_symbols - begin_symbol - count;
+    const SyncCheckpoint& checkpoint = index->get()[index->find(first)];
+    
+    decode_checkpoint(checkpoint, first - checkpoint.output_offset, count,
+        out, in, tab, true);
+}
+
+template<typename Types>
+void MulticoreBasicDecoder<Types>::decode_phase1(
+    size_t thread_id,
+    size_t begin,
+    size_t end,
+    size_t subsequence,
+    size_t subsequence_size,
+    size_t num_units,
+    size_t num_threads,
+    std::shared_ptr<size_t[]> out_positions,
+    std::shared_ptr<OutputBuffer> out,
+    std::shared_ptr<InputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    std::shared_ptr<SubsequenceSyncPoint[]> sync_info,
+    std::shared_ptr<std::vector<size_t>> thread_synced,
+    bool overflow,
+    bool write,
+    SpeculativeOutput* speculative,
+    bool forward,
+    const SubsequenceSyncPoint* start) {
+    
+    auto kernel = phase1_generic<size_t, size_t, size_t, size_t, size_t,
+        size_t, size_t, std::shared_ptr<size_t[]>,
+        std::shared_ptr<OutputBuffer>, std::shared_ptr<InputBuffer>,
+        std::shared_ptr<Codetable>,
+        std::shared_ptr<SubsequenceSyncPoint[]>,
+        std::shared_ptr<std::vector<size_t>>, bool, bool, SpeculativeOutput*,
+        bool, const SubsequenceSyncPoint*>;
+    
+    switch(CUHDDispatch::get_instruction_set()) {
+        case CUHDInstructionSet::SSE42: kernel = phase1_sse42; break;
+        case CUHDInstructionSet::AVX2: kernel = phase1_avx2; break;
+        case CUHDInstructionSet::AVX512: kernel = phase1_avx512; break;
+        default: break;
+    }
+    
+    kernel(thread_id, begin, end, subsequence, subsequence_size, num_units,
+        num_threads, out_positions, out, in, tab, sync_info, thread_synced,
+        overflow, write, speculative, forward, start);
 }
 
-std::vector<DecoderInterval> MulticoreDecoder::get_decoder_intervals(
+template<typename Types>
+void MulticoreBasicDecoder<Types>::decode_checkpoint(
+    const SyncCheckpoint& checkpoint,
+    size_t skip,
+    size_t num_symbols,
+    symbol_type* out,
+    std::shared_ptr<InputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    bool forward) {
+    
+    auto kernel = checkpoint_generic<const SyncCheckpoint&, size_t,
+        size_t, symbol_type*, std::shared_ptr<InputBuffer>,
+        std::shared_ptr<Codetable>, bool>;
+    
+    switch(CUHDDispatch::get_instruction_set()) {
+        case CUHDInstructionSet::SSE42: kernel = checkpoint_sse42; break;
+        case CUHDInstructionSet::AVX2: kernel = checkpoint_avx2; break;
+        case CUHDInstructionSet::AVX512: kernel = checkpoint_avx512; break;
+        default: break;
+    }
+    
+    kernel(checkpoint, skip, num_symbols, out, in, tab, forward);
+}
+
+template<typename Types>
+void MulticoreBasicDecoder<Types>::get_decoder_intervals(
     size_t subsequence_size,
     size_t num_threads,
-    size_t input_size_units) {
+    size_t input_size_units,
+    std::vector<DecoderInterval>& vals) {
     
     size_t num_subsequences = input_size_units / subsequence_size;
     size_t num_remaining = input_size_units % subsequence_size;
@@ -288,7 +534,7 @@ std::vector<DecoderInterval> MulticoreDecoder::get_decoder_intervals(
     size_t subs_per_thread = num_subsequences / num_threads;
     size_t remaining_subs = num_subsequences % num_threads;
     
-    std::vector<DecoderInterval> vals(num_threads);
+    vals.resize(num_threads);
     
     size_t at = 0;
     for(size_t i = 0; i < num_threads; ++i) {
@@ -298,11 +544,10 @@ std::vector<DecoderInterval> MulticoreDecoder::get_decoder_intervals(
     }
     
     vals.at(num_threads - 1).end += remaining_subs * subsequence_size;
-    
-    return vals;
 }
 
-void MulticoreDecoder::prefix_sum(
+template<typename Types>
+void MulticoreBasicDecoder<Types>::prefix_sum(
     std::shared_ptr<SubsequenceSyncPoint[]> sync_info,
     std::shared_ptr<size_t[]> out_positions,
     size_t num_subsequences,
@@ -332,3 +577,4 @@ void MulticoreDecoder::prefix_sum(
     }
 }
 
+CUHD_INSTANTIATE(MulticoreBasicDecoder)
@@ -0,0 +1,227 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "multicore_decoder.h"
+#include "multicore_decoder_session.h"
+#include "cuhd_bit_io.h"
+
+#include <cassert>
+
+namespace {
+
+    // bits of the stream starting at the current position
+    template<typename Types>
+    struct InterleavedReader {
+        const typename Types::unit_type* in_ptr;
+        size_t in_pos;
+        std::uint32_t at;
+        
+        // the current and the next unit, shifted to the start
+        typename Types::window_type window;
+    };
+    
+    // decodes one symbol with the given state
+    template<typename Types>
+    CUHD_FORCE_INLINE typename Types::symbol_type interleaved_step(
+        typename Types::state_type& state,
+        const CUHDBasicCodetableItem<Types>* table,
+        typename Types::state_type number_of_states,
+        InterleavedReader<Types>& reader) {
+        
+        typedef typename Types::unit_type unit_type;
+        
+        const std::uint32_t bits_in_unit = sizeof(unit_type) * 8;
+        const unit_type mask = (unit_type) (0) - 1;
+        
+        const CUHDBasicCodetableItem<Types> hit
+            = table[state - number_of_states];
+        
+        size_t taken = hit.min_num_bits;
+        state = (hit.next_state << taken)
+            + (unit_type) (~(mask << taken) & reader.window);
+        
+        while(state < number_of_states) {
+            const unit_type shift = reader.window >> taken;
+            ++taken;
+            state = (state << 1) + (~(mask << 1) & shift);
+        }
+        
+        reader.window >>= taken;
+        reader.at += taken;
+        
+        // refill, skipping the bits already taken from the next unit
+        if(reader.at >= bits_in_unit) {
+            ++reader.in_pos;
+            reader.at -= bits_in_unit;
+            reader.window = cuhd::load_window<Types>(
+                reader.in_ptr + reader.in_pos) >> reader.at;
+        }
+        
+        return hit.symbol;
+    }
+    
+    // the states are kept in registers, each round decodes one symbol per
+    // state, so NUM_STATES independent table lookups are in flight
+    template<size_t NUM_STATES, typename Types>
+    CUHD_FORCE_INLINE void interleaved_kernel(
+        const CUHDBasicInterleavedCheckpoint<Types>& checkpoint,
+        size_t num_symbols,
+        typename Types::symbol_type* out,
+        std::shared_ptr<CUHDBasicInterleavedInputBuffer<Types>> in,
+        std::shared_ptr<CUHDBasicCodetable<Types>> tab,
+        bool forward) {
+        
+        typedef typename Types::state_type state_type;
+        
+        std::shared_ptr<CUHDBasicInputBuffer<Types>> stream
+            = in->get_stream();
+        
+        const CUHDBasicCodetableItem<Types>* table = tab->get();
+        const state_type number_of_states = tab->get_num_entries();
+        
+        InterleavedReader<Types> reader;
+        reader.in_ptr = stream->get_compressed_data();
+        reader.in_pos = checkpoint.unit;
+        reader.at = checkpoint.bit;
+        reader.window = cuhd::load_window<Types>(
+            reader.in_ptr + reader.in_pos) >> reader.at;
+        
+        // the symbols are decoded last to first, rotate the states so that
+        // the first symbol to decode belongs to states[NUM_STATES - 1]
+        const size_t first = (in->get_num_symbols() - 1
+            - checkpoint.output_offset) % NUM_STATES;
+        
+        state_type states[NUM_STATES];
+        
+        for(size_t i = 0; i < NUM_STATES; ++i)
+            states[i] = checkpoint.states[(i + first + 1) % NUM_STATES];
+        
+        // in forward order the symbols are written from the back
+        typename Types::symbol_type* out_base
+            = forward ? out + num_symbols - 1 : out;
+        const std::ptrdiff_t out_step = forward ? -1 : 1;
+        
+        std::ptrdiff_t out_pos = 0;
+        const std::ptrdiff_t out_size = num_symbols;
+        
+        while(out_pos + (std::ptrdiff_t) NUM_STATES <= out_size) {
+            for(size_t i = NUM_STATES; i-- > 0;) {
+                out_base[out_step * out_pos++] = interleaved_step(states[i],
+                    table, number_of_states, reader);
+            }
+        }
+        
+        for(size_t i = NUM_STATES; i-- > 0 && out_pos < out_size;) {
+            out_base[out_step * out_pos++] = interleaved_step(states[i],
+                table, number_of_states, reader);
+        }
+    }
+    
+    template<typename Types>
+    CUHD_FORCE_INLINE void interleaved_dispatch(
+        const CUHDBasicInterleavedCheckpoint<Types>& checkpoint,
+        size_t num_symbols,
+        typename Types::symbol_type* out,
+        std::shared_ptr<CUHDBasicInterleavedInputBuffer<Types>> in,
+        std::shared_ptr<CUHDBasicCodetable<Types>> tab,
+        bool forward) {
+        
+        switch(in->get_num_states()) {
+            case 2:
+                interleaved_kernel<2>(checkpoint, num_symbols, out, in, tab,
+                    forward);
+                break;
+            case 4:
+                interleaved_kernel<4>(checkpoint, num_symbols, out, in, tab,
+                    forward);
+                break;
+            case 8:
+                interleaved_kernel<8>(checkpoint, num_symbols, out, in, tab,
+                    forward);
+                break;
+            default:
+                assert(false);
+        }
+    }
+    
+    // kernel variants, see CUHDDispatch
+    template<typename... Args>
+    void interleaved_generic(Args... args) {
+        interleaved_dispatch(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_SSE42 void interleaved_sse42(Args... args) {
+        interleaved_dispatch(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_AVX2 void interleaved_avx2(Args... args) {
+        interleaved_dispatch(args...);
+    }
+    
+    template<typename... Args>
+    CUHD_TARGET_AVX512 void interleaved_avx512(Args... args) {
+        interleaved_dispatch(args...);
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoder<Types>::decode_interleaved(
+    size_t num_threads,
+    std::shared_ptr<OutputBuffer> out,
+    std::shared_ptr<InterleavedInputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    MulticoreDecoderOptions options) {
+    
+    MulticoreBasicDecoderSession<Types> session(num_threads, options);
+    session.decode_interleaved(out, in, tab);
+}
+
+template<typename Types>
+void MulticoreBasicDecoder<Types>::decode_interleaved_checkpoint(
+    const InterleavedCheckpoint& checkpoint,
+    size_t num_symbols,
+    symbol_type* out,
+    std::shared_ptr<InterleavedInputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    bool forward) {
+    
+    if(num_symbols == 0) return;
+    
+    auto kernel = interleaved_generic<const InterleavedCheckpoint&,
+        size_t, symbol_type*, std::shared_ptr<InterleavedInputBuffer>,
+        std::shared_ptr<Codetable>, bool>;
+    
+    switch(CUHDDispatch::get_instruction_set()) {
+        case CUHDInstructionSet::SSE42: kernel = interleaved_sse42; break;
+        case CUHDInstructionSet::AVX2: kernel = interleaved_avx2; break;
+        case CUHDInstructionSet::AVX512: kernel = interleaved_avx512; break;
+        default: break;
+    }
+    
+    kernel(checkpoint, num_symbols, out, in, tab, forward);
+}
+
+// the other members are instantiated in multicore_decoder.cc
+#define INSTANTIATE_INTERLEAVED(TYPES) \
+    template void MulticoreBasicDecoder<TYPES>::decode_interleaved( \
+        size_t, std::shared_ptr<CUHDBasicOutputBuffer<TYPES>>, \
+        std::shared_ptr<CUHDBasicInterleavedInputBuffer<TYPES>>, \
+        std::shared_ptr<CUHDBasicCodetable<TYPES>>, \
+        MulticoreDecoderOptions); \
+    template void MulticoreBasicDecoder<TYPES>:: \
+        decode_interleaved_checkpoint( \
+        const CUHDBasicInterleavedCheckpoint<TYPES>&, size_t, \
+        TYPES::symbol_type*, \
+        std::shared_ptr<CUHDBasicInterleavedInputBuffer<TYPES>>, \
+        std::shared_ptr<CUHDBasicCodetable<TYPES>>, bool);
+
+CUHD_FOR_EACH_TYPES(INSTANTIATE_INTERLEAVED)
@@ -0,0 +1,758 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "multicore_decoder_session.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+    // states of a task in the sync pass of WORK_STEALING
+    const std::uint8_t TASK_IDLE = 0;
+    const std::uint8_t TASK_QUEUED = 1;
+    const std::uint8_t TASK_RUNNING = 2;
+
+    // running, but its start point changed in the meantime
+    const std::uint8_t TASK_DIRTY = 3;
+}
+
+template<typename Types>
+MulticoreBasicDecoderSession<Types>::MulticoreBasicDecoderSession(
+    size_t num_threads, MulticoreDecoderOptions options)
+    : num_threads_(num_threads),
+      options_(options),
+      generation_(0),
+      num_pending_(0),
+      shutdown_(false),
+      pass_(Pass::PHASE1),
+      subsequence_size_(0),
+      input_size_units_(0),
+      intervals_(num_threads),
+      sync_info_size_(0),
+      out_positions_(CUHDAllocator::allocate_array<size_t>(
+          num_threads, options.allocator)),
+      thread_synced_(new std::vector<size_t>(num_threads, false)),
+      boundary_version_(new std::atomic<size_t>[num_threads]),
+      boundary_final_(new std::atomic<bool>[num_threads]),
+      boundary_(new std::atomic<std::uint64_t>[num_threads]),
+      speculative_(num_threads, SpeculativeOutput {nullptr, 0, 0, 0, false}),
+      num_speculative_fallbacks_(0),
+      num_tasks_(0),
+      tasks_size_(0),
+      task_synced_(new std::vector<size_t>()),
+      queues_(new TaskQueue[num_threads]),
+      simd_lanes_(1) {
+
+    assert(num_threads > 0);
+
+    for(size_t i = 1; i < num_threads_; ++i) {
+        workers_.push_back(std::thread(&MulticoreBasicDecoderSession::work,
+            this, i));
+    }
+}
+
+template<typename Types>
+MulticoreBasicDecoderSession<Types>::~MulticoreBasicDecoderSession() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+
+    wake_.notify_all();
+
+    for(auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::decode(
+    size_t subsequence_size,
+    size_t input_size_units,
+    std::shared_ptr<OutputBuffer> out,
+    std::shared_ptr<InputBuffer> in,
+    std::shared_ptr<Codetable> tab) {
+
+    // split units into subsequences
+    size_t num_subsequences = input_size_units / subsequence_size;
+    size_t num_remaining = input_size_units % subsequence_size;
+    if(num_remaining != 0) ++num_subsequences;
+
+    subsequence_size_ = subsequence_size;
+    input_size_units_ = input_size_units;
+    out_ = out;
+    in_ = in;
+    tab_ = tab;
+
+    if(options_.use_sync_index) sync_index_ = in->get_sync_index();
+
+    // the encoder already knows where each thread has to start
+    if(sync_index_) decode_indexed();
+
+    else switch(options_.sync_mode) {
+        case MulticoreSyncMode::ROUNDS:
+            decode_rounds(num_subsequences);
+            break;
+
+        case MulticoreSyncMode::WORK_STEALING:
+            decode_tasks(num_subsequences);
+            break;
+
+        case MulticoreSyncMode::PIPELINED:
+            decode_pipelined(num_subsequences);
+            break;
+    }
+
+    // do not keep the caller's buffers alive
+    out_.reset();
+    in_.reset();
+    tab_.reset();
+    sync_index_.reset();
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::decode_interleaved(
+    std::shared_ptr<OutputBuffer> out,
+    std::shared_ptr<InterleavedInputBuffer> in,
+    std::shared_ptr<Codetable> tab) {
+
+    out_ = out;
+    interleaved_in_ = in;
+    tab_ = tab;
+
+    run(Pass::INTERLEAVED);
+
+    out_.reset();
+    interleaved_in_.reset();
+    tab_.reset();
+}
+
+template<typename Types>
+size_t MulticoreBasicDecoderSession<Types>::synchronise_window(
+    size_t subsequence_size,
+    size_t input_size_units,
+    std::shared_ptr<InputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    SubsequenceSyncPoint& last) {
+
+    // the sync point of a partial subsequence is never recorded
+    assert(input_size_units % subsequence_size == 0);
+
+    const size_t num_subsequences = input_size_units / subsequence_size;
+
+    subsequence_size_ = subsequence_size;
+    input_size_units_ = input_size_units;
+    in_ = in;
+    tab_ = tab;
+
+    reserve(num_subsequences, 0);
+    synchronise_rounds();
+
+    // the counts of all subsequences are final once the threads agree
+    const SubsequenceSyncPoint* sync = sync_info_.get();
+
+    size_t num_symbols = 0;
+    for(size_t i = 0; i < num_subsequences; ++i)
+        num_symbols += sync[i].num_symbols;
+
+    last = sync[num_subsequences - 1];
+
+    return num_symbols;
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::write_window(
+    std::shared_ptr<OutputBuffer> out) {
+
+    out_ = out;
+
+    Decoder::prefix_sum(sync_info_, out_positions_,
+        input_size_units_ / subsequence_size_, num_threads_);
+
+    run(Pass::WRITE);
+    update_speculative();
+
+    out_.reset();
+    in_.reset();
+    tab_.reset();
+}
+
+template<typename Types>
+size_t MulticoreBasicDecoderSession<Types>::get_num_threads() {
+    return num_threads_;
+}
+
+template<typename Types>
+size_t MulticoreBasicDecoderSession<Types>::get_num_speculative_fallbacks() {
+    return num_speculative_fallbacks_;
+}
+
+template<typename Types>
+MulticoreDecoderOptions MulticoreBasicDecoderSession<Types>::get_options() {
+    return options_;
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::set_options(
+    MulticoreDecoderOptions options) {
+    options_ = options;
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::decode_rounds(
+    size_t num_subsequences) {
+    reserve(num_subsequences, 0);
+    reserve_speculative(out_->get_uncompressed_size());
+
+    synchronise_rounds();
+
+    Decoder::prefix_sum(sync_info_, out_positions_,
+        num_subsequences, num_threads_);
+
+    run(Pass::WRITE);
+    update_speculative();
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::synchronise_rounds() {
+
+    // spread subsequences over multiple threads
+    Decoder::get_decoder_intervals(
+        subsequence_size_, num_threads_, input_size_units_, intervals_);
+
+    std::fill(thread_synced_->begin(), thread_synced_->end(), false);
+
+    run(Pass::PHASE1);
+
+    bool synchronized = false;
+
+    while(!synchronized) {
+        run(Pass::OVERFLOW);
+
+        synchronized = true;
+
+        for(size_t i = 1; i < num_threads_; ++i) {
+
+            // a thread that did not synchronize may have rewritten the
+            // start point its successor read concurrently in this round
+            if(i > 1 && !thread_synced_->at(i - 1))
+                thread_synced_->at(i) = false;
+
+            if(!thread_synced_->at(i)) synchronized = false;
+        }
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::decode_tasks(
+    size_t num_subsequences) {
+    const size_t per_task = std::max<size_t>(
+        options_.subsequences_per_task, 1);
+
+    // at least one task per thread
+    const size_t num_tasks = std::min(num_subsequences,
+        std::max(num_threads_, num_subsequences / per_task));
+
+    reserve(num_subsequences, num_tasks);
+    num_tasks_ = num_tasks;
+
+    Decoder::get_decoder_intervals(
+        subsequence_size_, num_tasks, input_size_units_, tasks_);
+
+    // phase 1, every task but the first starts at a guessed state
+    // gathers and scatters take 32-bit indices
+    simd_lanes_ = 1;
+    if(options_.simd_phase1 && input_size_units_ < (1u << 28))
+        simd_lanes_ = Decoder::get_phase1_lanes();
+
+    fill_queues(0);
+    run(Pass::TASK_PHASE1);
+
+    // phase 2, verify the start of each task against its predecessor
+    for(size_t i = 0; i < num_tasks; ++i) {
+        task_state_[i] = TASK_QUEUED;
+        task_synced_->at(i) = false;
+    }
+
+    fill_queues(1);
+    run(Pass::TASK_SYNC);
+
+    Decoder::prefix_sum(sync_info_, task_out_positions_,
+        num_subsequences, num_tasks);
+
+    fill_queues(0);
+    run(Pass::TASK_WRITE);
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::decode_pipelined(
+    size_t num_subsequences) {
+    reserve(num_subsequences, 0);
+    reserve_speculative(out_->get_uncompressed_size());
+
+    Decoder::get_decoder_intervals(
+        subsequence_size_, num_threads_, input_size_units_, intervals_);
+
+    for(size_t i = 0; i < num_threads_; ++i) {
+        boundary_version_[i] = 0;
+        boundary_final_[i] = false;
+    }
+
+    // phase 1 and 2 in a single pass
+    run(Pass::PIPELINED);
+
+    Decoder::prefix_sum(sync_info_, out_positions_,
+        num_subsequences, num_threads_);
+
+    run(Pass::WRITE);
+    update_speculative();
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::decode_indexed() {
+
+    // single pass, no synchronisation and no prefix sum required
+    run(Pass::INDEXED);
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::run(Pass pass) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pass_ = pass;
+        num_pending_ = num_threads_ - 1;
+        ++generation_;
+    }
+
+    wake_.notify_all();
+
+    execute(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&]() {return num_pending_ == 0;});
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::work(size_t thread_id) {
+    size_t generation = 0;
+
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&]() {
+                return shutdown_ || generation_ != generation;});
+
+            if(shutdown_) return;
+            generation = generation_;
+        }
+
+        execute(thread_id);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(--num_pending_ == 0) done_.notify_one();
+        }
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::execute(size_t thread_id) {
+    size_t task;
+
+    switch(pass_) {
+        case Pass::PHASE1:
+        case Pass::OVERFLOW:
+        case Pass::WRITE: {
+            const bool overflow = pass_ == Pass::OVERFLOW;
+
+            // the first thread always starts at a known state
+            if(overflow && thread_id == 0) return;
+
+            const DecoderInterval& interval = intervals_[thread_id];
+
+            Decoder::decode_phase1(thread_id,
+                interval.begin, interval.end, interval.sub,
+                subsequence_size_, input_size_units_, num_threads_,
+                out_positions_, out_, in_, tab_, sync_info_, thread_synced_,
+                overflow, pass_ == Pass::WRITE, get_speculative(thread_id),
+                options_.forward_output);
+            break;
+        }
+
+        case Pass::PIPELINED:
+            pipeline(thread_id);
+            break;
+
+        case Pass::TASK_PHASE1:
+            if(simd_lanes_ > 1) {
+                decode_tasks_simd(thread_id);
+                break;
+            }
+
+            // fall through
+        case Pass::TASK_WRITE:
+            while(next_task(thread_id, task)) {
+                const DecoderInterval& interval = tasks_[task];
+
+                Decoder::decode_phase1(task,
+                    interval.begin, interval.end, interval.sub,
+                    subsequence_size_, input_size_units_, num_tasks_,
+                    task_out_positions_, out_, in_, tab_, sync_info_,
+                    task_synced_, false, pass_ == Pass::TASK_WRITE, nullptr,
+                    options_.forward_output);
+            }
+            break;
+
+        case Pass::TASK_SYNC:
+            while(next_task(thread_id, task)) {
+                std::uint8_t expected = TASK_QUEUED;
+
+                // tasks may have been claimed by their predecessor already
+                if(task_state_[task].compare_exchange_strong(
+                    expected, TASK_RUNNING)) sync_task(task);
+            }
+            break;
+
+        case Pass::INDEXED: {
+            const size_t num_checkpoints = sync_index_->get_num_checkpoints();
+            const typename Decoder::SyncCheckpoint* checkpoints
+                = sync_index_->get();
+            const size_t size_out = out_->get_uncompressed_size();
+
+            // consecutive checkpoints for each thread
+            const size_t first = (num_checkpoints * thread_id) / num_threads_;
+            const size_t last
+                = (num_checkpoints * (thread_id + 1)) / num_threads_;
+
+            if(first == last) break;
+
+            const size_t begin = std::min(
+                checkpoints[first].output_offset, size_out);
+            const size_t end = last < num_checkpoints
+                ? std::min(checkpoints[last].output_offset, size_out)
+                : size_out;
+
+            // in forward order the range is mirrored
+            const size_t at = options_.forward_output
+                ? size_out - end : begin;
+
+            Decoder::decode_checkpoint(checkpoints[first], 0,
+                end - begin, out_->get_decompressed_data().get() + at,
+                in_, tab_, options_.forward_output);
+            break;
+        }
+
+        case Pass::INTERLEAVED: {
+            const size_t num_checkpoints
+                = interleaved_in_->get_num_checkpoints();
+            const typename Decoder::InterleavedCheckpoint* checkpoints
+                = interleaved_in_->get_checkpoints();
+            const size_t size_out = std::min(out_->get_uncompressed_size(),
+                interleaved_in_->get_num_symbols());
+
+            const size_t first = (num_checkpoints * thread_id) / num_threads_;
+            const size_t last
+                = (num_checkpoints * (thread_id + 1)) / num_threads_;
+
+            if(first == last) break;
+
+            const size_t begin = std::min(
+                checkpoints[first].output_offset, size_out);
+            const size_t end = last < num_checkpoints
+                ? std::min(checkpoints[last].output_offset, size_out)
+                : size_out;
+
+            const size_t at = options_.forward_output
+                ? size_out - end : begin;
+
+            Decoder::decode_interleaved_checkpoint(
+                checkpoints[first], end - begin,
+                out_->get_decompressed_data().get() + at,
+                interleaved_in_, tab_, options_.forward_output);
+            break;
+        }
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::pipeline(size_t thread_id) {
+    const DecoderInterval& interval = intervals_[thread_id];
+
+    auto decode = [&](bool overflow, const SubsequenceSyncPoint* start) {
+        Decoder::decode_phase1(thread_id,
+            interval.begin, interval.end, interval.sub,
+            subsequence_size_, input_size_units_, num_threads_,
+            out_positions_, out_, in_, tab_, sync_info_, thread_synced_,
+            overflow, false, get_speculative(thread_id),
+            options_.forward_output, start);
+    };
+
+    decode(false, nullptr);
+
+    // publish the start point of the successor
+    publish_boundary(thread_id);
+    boundary_version_[thread_id] = 1;
+
+    if(thread_id == 0) {
+        boundary_final_[0] = true;
+        return;
+    }
+
+    std::atomic<size_t>& version = boundary_version_[thread_id - 1];
+    std::atomic<bool>& final = boundary_final_[thread_id - 1];
+
+    while(version.load() == 0) std::this_thread::yield();
+
+    while(true) {
+        const size_t verified = version.load();
+
+        // the predecessor may be rewriting its sync points, the start
+        // point is the copy published before the version
+        const SubsequenceSyncPoint start = unpack_boundary(
+            boundary_[thread_id - 1].load(std::memory_order_acquire));
+
+        thread_synced_->at(thread_id) = false;
+        decode(true, &start);
+
+        // no sync point found, the whole interval has been rewritten
+        if(!thread_synced_->at(thread_id)) {
+            publish_boundary(thread_id);
+            ++boundary_version_[thread_id];
+        }
+
+        // wait until the start point is final or changes again
+        while(!final.load() && version.load() == verified)
+            std::this_thread::yield();
+
+        if(final.load() && version.load() == verified) break;
+    }
+
+    boundary_final_[thread_id] = true;
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::publish_boundary(
+    size_t thread_id) {
+
+    if(thread_id + 1 == num_threads_) return;
+
+    boundary_[thread_id].store(pack_boundary(
+        sync_info_[intervals_[thread_id + 1].sub - 1]),
+        std::memory_order_release);
+}
+
+template<typename Types>
+std::uint64_t MulticoreBasicDecoderSession<Types>::pack_boundary(
+    const SubsequenceSyncPoint& sp) {
+
+    static_assert(Types::max_num_states <= ((size_t) 1 << 24),
+        "states do not fit into 25 bits");
+
+    return (std::uint64_t) sp.state | ((std::uint64_t) sp.bit << 25)
+        | ((std::uint64_t) sp.unit << 32);
+}
+
+template<typename Types>
+typename MulticoreBasicDecoderSession<Types>::SubsequenceSyncPoint
+    MulticoreBasicDecoderSession<Types>::unpack_boundary(
+    std::uint64_t packed) {
+
+    SubsequenceSyncPoint sp;
+    sp.state = packed & ((1u << 25) - 1);
+    sp.bit = (packed >> 25) & 127;
+    sp.unit = packed >> 32;
+    sp.num_symbols = 0;
+
+    return sp;
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::fill_queues(size_t first) {
+    const size_t num = num_tasks_ - first;
+
+    // workers are parked, no locking required
+    for(size_t i = 0; i < num_threads_; ++i) {
+        queues_[i].begin = first + (num * i) / num_threads_;
+        queues_[i].end = first + (num * (i + 1)) / num_threads_;
+    }
+}
+
+template<typename Types>
+bool MulticoreBasicDecoderSession<Types>::next_task(size_t thread_id,
+    size_t& task) {
+    TaskQueue& own = queues_[thread_id];
+
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+
+        if(own.begin < own.end) {
+            task = own.begin++;
+            return true;
+        }
+    }
+
+    // steal the back half of another queue
+    for(size_t i = 1; i < num_threads_; ++i) {
+        TaskQueue& victim = queues_[(thread_id + i) % num_threads_];
+        size_t begin, end;
+
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+
+            const size_t available = victim.end - victim.begin;
+            if(available == 0) continue;
+
+            end = victim.end;
+            begin = end - (available + 1) / 2;
+            victim.end = begin;
+        }
+
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin + 1;
+        own.end = end;
+        task = begin;
+
+        return true;
+    }
+
+    return false;
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::decode_tasks_simd(size_t thread_id) {
+    size_t ids[16];
+
+    while(true) {
+        size_t num = 0;
+        while(num < simd_lanes_ && next_task(thread_id, ids[num])) ++num;
+
+        if(num == 0) return;
+
+        Decoder::decode_phase1_simd(ids, num, tasks_,
+            subsequence_size_, in_, tab_, sync_info_);
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::sync_task(size_t task) {
+    while(true) {
+        const DecoderInterval& interval = tasks_[task];
+        bool rewritten = false;
+
+        // decode again while the predecessor keeps changing our start point
+        while(true) {
+            task_synced_->at(task) = false;
+
+            Decoder::decode_phase1(task,
+                interval.begin, interval.end, interval.sub,
+                subsequence_size_, input_size_units_, num_tasks_,
+                task_out_positions_, out_, in_, tab_, sync_info_,
+                task_synced_, true, false, nullptr, options_.forward_output);
+
+            if(!task_synced_->at(task)) rewritten = true;
+
+            std::uint8_t expected = TASK_RUNNING;
+            if(task_state_[task].compare_exchange_strong(expected, TASK_IDLE))
+                break;
+
+            task_state_[task] = TASK_RUNNING;
+        }
+
+        // no sync point found, the start point of the successor changed
+        if(!rewritten || task + 1 == num_tasks_) return;
+
+        ++task;
+        std::uint8_t state = task_state_[task].load();
+
+        // claim the successor or tell its current owner to start over
+        while(true) {
+            if(state == TASK_DIRTY) return;
+
+            if(state == TASK_RUNNING) {
+                if(task_state_[task].compare_exchange_weak(state, TASK_DIRTY))
+                    return;
+            }
+
+            else if(task_state_[task].compare_exchange_weak(
+                state, TASK_RUNNING)) break;
+        }
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::reserve(size_t num_subsequences,
+    size_t num_tasks) {
+
+    if(num_subsequences > sync_info_size_) {
+        sync_info_ = CUHDAllocator::allocate_array<SubsequenceSyncPoint>(
+            num_subsequences, options_.allocator);
+        sync_info_size_ = num_subsequences;
+    }
+
+    if(num_tasks > tasks_size_) {
+        task_out_positions_ = CUHDAllocator::allocate_array<size_t>(
+            num_tasks, options_.allocator);
+        task_state_.reset(new std::atomic<std::uint8_t>[num_tasks]);
+        tasks_size_ = num_tasks;
+    }
+
+    task_synced_->resize(num_tasks);
+}
+
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::reserve_speculative(
+    size_t output_size) {
+    if(!options_.speculative_write) return;
+
+    // threads starting at a wrong state may decode a few more symbols
+    const size_t per_thread = output_size / num_threads_;
+    const size_t capacity = per_thread + per_thread / 8 + 4096;
+
+    for(auto& speculative : speculative_) {
+        if(capacity > speculative.capacity) {
+            speculative.symbols = CUHDAllocator::allocate_array<
+                typename Types::symbol_type>(capacity, options_.allocator);
+            speculative.capacity = capacity;
+        }
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoderSession<Types>::update_speculative() {
+    if(!options_.speculative_write) return;
+
+    // phase 1 counts all symbols of the interval, also those which did not
+    // fit, the next decode of a similar stream keeps all of them
+    for(auto& speculative : speculative_) {
+        if(speculative.size <= speculative.capacity) continue;
+
+        ++num_speculative_fallbacks_;
+
+        const size_t capacity = speculative.size + speculative.size / 8;
+
+        speculative.symbols = CUHDAllocator::allocate_array<
+            typename Types::symbol_type>(capacity, options_.allocator);
+        speculative.capacity = capacity;
+        speculative.size = 0;
+    }
+}
+
+template<typename Types>
+typename MulticoreBasicDecoderSession<Types>::SpeculativeOutput*
+    MulticoreBasicDecoderSession<Types>::get_speculative(
+    size_t thread_id) {
+
+    if(!options_.speculative_write) return nullptr;
+    return &speculative_[thread_id];
+}
+
+CUHD_INSTANTIATE(MulticoreBasicDecoderSession)
@@ -0,0 +1,401 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "multicore_decoder.h"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef MULTIANS_SIMD
+#include <immintrin.h>
+#endif
+
+template<typename Types>
+size_t MulticoreBasicDecoder<Types>::get_phase1_lanes() {
+
+    // the kernels gather 32-bit units and table items and scatter sync
+    // points made of four 32-bit words
+    if(sizeof(typename Types::unit_type) != 4
+        || sizeof(CUHDBasicCodetableItem<Types>) != 4
+        || sizeof(SubsequenceSyncPoint) != 16) return 1;
+
+    switch(CUHDDispatch::get_instruction_set()) {
+        case CUHDInstructionSet::AVX512: return 16;
+        case CUHDInstructionSet::AVX2: return 8;
+        default: return 1;
+    }
+}
+
+template<typename Types>
+void MulticoreBasicDecoder<Types>::decode_phase1_simd(
+    const size_t* ids,
+    size_t num_lanes,
+    const std::vector<DecoderInterval>& intervals,
+    size_t subsequence_size,
+    std::shared_ptr<InputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    std::shared_ptr<SubsequenceSyncPoint[]> sync_info) {
+
+    const size_t lanes = get_phase1_lanes();
+    assert(lanes > 1 && num_lanes <= lanes);
+
+    #ifdef MULTIANS_SIMD
+    if(lanes == 16) {
+        decode_phase1_avx512(ids, num_lanes, intervals, subsequence_size,
+            in, tab, sync_info);
+    }
+
+    else {
+        decode_phase1_avx2(ids, num_lanes, intervals, subsequence_size,
+            in, tab, sync_info);
+    }
+    #endif
+}
+
+#ifdef MULTIANS_SIMD
+
+namespace {
+
+    // per lane state of the vectorised phase 1
+    struct LaneState {
+        std::uint32_t state[16];
+        std::uint32_t at[16];
+        std::uint32_t pos[16];
+        std::uint32_t end[16];
+        std::uint32_t unit[16];
+        std::uint32_t num_symbols[16];
+        std::uint32_t last_state[16];
+        std::uint32_t last_bit[16];
+        std::uint32_t subsequence[16];
+    };
+
+    template<typename Types>
+    void init_lanes(LaneState& lanes, size_t num_lanes, size_t max_lanes,
+        const size_t* ids, const std::vector<DecoderInterval>& intervals,
+        std::shared_ptr<CUHDBasicInputBuffer<Types>> in) {
+
+        const size_t bits_in_unit = in->get_unit_size() * 8;
+
+        for(size_t i = 0; i < max_lanes; ++i) {
+            lanes.state[i] = in->get_first_state();
+            lanes.at[i] = 0;
+            lanes.pos[i] = 0;
+            lanes.end[i] = 0;
+            lanes.unit[i] = 0;
+            lanes.num_symbols[i] = 0;
+            lanes.last_state[i] = 0;
+            lanes.last_bit[i] = 0;
+            lanes.subsequence[i] = 0;
+
+            // unused lanes stay inactive
+            if(i >= num_lanes) continue;
+
+            const DecoderInterval& interval = intervals[ids[i]];
+
+            if(ids[i] == 0) lanes.at[i] = bits_in_unit - in->get_first_bit();
+            lanes.pos[i] = interval.begin;
+            // the last subsequence may be partial, see decode_phase1
+            lanes.end[i] = std::min(interval.end, in->get_compressed_size());
+            lanes.subsequence[i] = (std::uint32_t) interval.sub;
+        }
+    }
+
+    // records the sync points of all lanes in mask that completed a
+    // subsequence, same as decode_phase1 (AVX2 has no scatter)
+    template<typename SyncPoint>
+    void complete_subsequences(LaneState& lanes, std::uint32_t mask,
+        size_t subsequence_size, SyncPoint* sync) {
+
+        while(mask != 0) {
+            const size_t i = __builtin_ctz(mask);
+            mask &= mask - 1;
+
+            sync[lanes.subsequence[i]] = {lanes.last_state[i],
+                lanes.last_bit[i], (std::uint32_t) subsequence_size - 1,
+                lanes.num_symbols[i]};
+
+            ++lanes.subsequence[i];
+            lanes.unit[i] = 0;
+            lanes.num_symbols[i] = 0;
+        }
+    }
+}
+
+template<typename Types>
+CUHD_TARGET_AVX2
+void MulticoreBasicDecoder<Types>::decode_phase1_avx2(
+    const size_t* ids,
+    size_t num_lanes,
+    const std::vector<DecoderInterval>& intervals,
+    size_t subsequence_size,
+    std::shared_ptr<InputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    std::shared_ptr<SubsequenceSyncPoint[]> sync_info) {
+
+    LaneState lanes;
+    init_lanes(lanes, num_lanes, 8, ids, intervals, in);
+
+    const int* in_ptr = (const int*) in->get_compressed_data();
+    const int* table = (const int*) tab->get();
+    SubsequenceSyncPoint* sync = sync_info.get();
+
+    const __m256i number_of_states = _mm256_set1_epi32(
+        tab->get_num_entries());
+    const __m256i bits_in_unit = _mm256_set1_epi32(32);
+    const __m256i subsequence_units = _mm256_set1_epi32(subsequence_size);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i mask = _mm256_set1_epi32(-1);
+    const __m256i state_mask = _mm256_set1_epi32(0xFFFF);
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i state = _mm256_loadu_si256((__m256i*) lanes.state);
+    __m256i at = _mm256_loadu_si256((__m256i*) lanes.at);
+    __m256i pos = _mm256_loadu_si256((__m256i*) lanes.pos);
+    __m256i end = _mm256_loadu_si256((__m256i*) lanes.end);
+    __m256i unit = _mm256_loadu_si256((__m256i*) lanes.unit);
+    __m256i num_symbols = _mm256_loadu_si256((__m256i*) lanes.num_symbols);
+    __m256i last_state = _mm256_loadu_si256((__m256i*) lanes.last_state);
+    __m256i last_bit = _mm256_loadu_si256((__m256i*) lanes.last_bit);
+
+    __m256i active = _mm256_cmpgt_epi32(end, pos);
+
+    while(_mm256_movemask_epi8(active) != 0) {
+
+        // refill decoder windows of lanes that consumed their unit
+        const __m256i refill = _mm256_and_si256(active,
+            _mm256_cmpgt_epi32(at, _mm256_sub_epi32(bits_in_unit, one)));
+
+        if(_mm256_movemask_epi8(refill) != 0) {
+            pos = _mm256_sub_epi32(pos, refill);
+            unit = _mm256_sub_epi32(unit, refill);
+            at = _mm256_sub_epi32(at,
+                _mm256_and_si256(refill, bits_in_unit));
+
+            const __m256i complete = _mm256_and_si256(refill,
+                _mm256_cmpeq_epi32(unit, subsequence_units));
+            const std::uint32_t complete_mask = _mm256_movemask_ps(
+                _mm256_castsi256_ps(complete));
+
+            if(complete_mask != 0) {
+                _mm256_storeu_si256((__m256i*) lanes.unit, unit);
+                _mm256_storeu_si256((__m256i*) lanes.num_symbols,
+                    num_symbols);
+                _mm256_storeu_si256((__m256i*) lanes.last_state, last_state);
+                _mm256_storeu_si256((__m256i*) lanes.last_bit, last_bit);
+
+                complete_subsequences(lanes, complete_mask,
+                    subsequence_size, sync);
+
+                unit = _mm256_loadu_si256((__m256i*) lanes.unit);
+                num_symbols = _mm256_loadu_si256(
+                    (__m256i*) lanes.num_symbols);
+            }
+
+            active = _mm256_cmpgt_epi32(end, pos);
+            if(_mm256_movemask_epi8(active) == 0) break;
+        }
+
+        // 32 bits of input starting at bit at of unit pos
+        const __m256i lo = _mm256_mask_i32gather_epi32(zero, in_ptr,
+            pos, active, 4);
+        const __m256i hi = _mm256_mask_i32gather_epi32(zero, in_ptr,
+            _mm256_add_epi32(pos, one), active, 4);
+        const __m256i window = _mm256_or_si256(_mm256_srlv_epi32(lo, at),
+            _mm256_sllv_epi32(hi, _mm256_sub_epi32(bits_in_unit, at)));
+
+        // decode a symbol, a table item is gathered as a 32-bit word
+        // (next state in the low half, number of bits in the top byte)
+        const __m256i hit = _mm256_mask_i32gather_epi32(zero, table,
+            _mm256_sub_epi32(state, number_of_states), active, 4);
+
+        const __m256i next_state = _mm256_and_si256(hit, state_mask);
+        __m256i taken = _mm256_srli_epi32(hit, 24);
+
+        __m256i current_state = _mm256_add_epi32(
+            _mm256_sllv_epi32(next_state, taken),
+            _mm256_andnot_si256(_mm256_sllv_epi32(mask, taken), window));
+
+        __m256i renormalize = _mm256_and_si256(active,
+            _mm256_cmpgt_epi32(number_of_states, current_state));
+
+        while(_mm256_movemask_epi8(renormalize) != 0) {
+            const __m256i bit = _mm256_and_si256(
+                _mm256_srlv_epi32(window, taken), one);
+
+            current_state = _mm256_blendv_epi8(current_state,
+                _mm256_add_epi32(_mm256_slli_epi32(current_state, 1), bit),
+                renormalize);
+            taken = _mm256_sub_epi32(taken, renormalize);
+
+            renormalize = _mm256_and_si256(active,
+                _mm256_cmpgt_epi32(number_of_states, current_state));
+        }
+
+        last_state = _mm256_blendv_epi8(last_state, state, active);
+        last_bit = _mm256_blendv_epi8(last_bit, at, active);
+        state = _mm256_blendv_epi8(state, current_state, active);
+        num_symbols = _mm256_sub_epi32(num_symbols, active);
+        at = _mm256_add_epi32(at, _mm256_and_si256(taken, active));
+    }
+}
+
+template<typename Types>
+CUHD_TARGET_AVX512
+void MulticoreBasicDecoder<Types>::decode_phase1_avx512(
+    const size_t* ids,
+    size_t num_lanes,
+    const std::vector<DecoderInterval>& intervals,
+    size_t subsequence_size,
+    std::shared_ptr<InputBuffer> in,
+    std::shared_ptr<Codetable> tab,
+    std::shared_ptr<SubsequenceSyncPoint[]> sync_info) {
+
+    LaneState lanes;
+    init_lanes(lanes, num_lanes, 16, ids, intervals, in);
+
+    const int* in_ptr = (const int*) in->get_compressed_data();
+    const int* table = (const int*) tab->get();
+    SubsequenceSyncPoint* sync = sync_info.get();
+
+    const __m512i number_of_states = _mm512_set1_epi32(
+        tab->get_num_entries());
+    const __m512i bits_in_unit = _mm512_set1_epi32(32);
+    const __m512i subsequence_units = _mm512_set1_epi32(subsequence_size);
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i mask = _mm512_set1_epi32(-1);
+    const __m512i state_mask = _mm512_set1_epi32(0xFFFF);
+    const __m512i zero = _mm512_setzero_si512();
+
+    __m512i state = _mm512_loadu_si512(lanes.state);
+    __m512i at = _mm512_loadu_si512(lanes.at);
+    __m512i pos = _mm512_loadu_si512(lanes.pos);
+    __m512i end = _mm512_loadu_si512(lanes.end);
+    __m512i unit = _mm512_loadu_si512(lanes.unit);
+    __m512i num_symbols = _mm512_loadu_si512(lanes.num_symbols);
+    __m512i last_state = _mm512_loadu_si512(lanes.last_state);
+    __m512i last_bit = _mm512_loadu_si512(lanes.last_bit);
+    __m512i subsequence = _mm512_loadu_si512(lanes.subsequence);
+
+    __mmask16 active = _mm512_cmpgt_epu32_mask(end, pos);
+
+    // 32 bits of input starting at bit at of unit pos and the bits of the
+    // next unit which have not been moved into the window yet
+    __m512i window = zero;
+    __m512i next = zero;
+    __mmask16 load = active;
+
+    while(active != 0) {
+
+        // refill decoder windows of lanes that consumed their unit
+        const __mmask16 refill = _mm512_mask_cmpge_epu32_mask(active,
+            at, bits_in_unit);
+
+        if(refill != 0) {
+            pos = _mm512_mask_add_epi32(pos, refill, pos, one);
+            unit = _mm512_mask_add_epi32(unit, refill, unit, one);
+            at = _mm512_mask_sub_epi32(at, refill, at, bits_in_unit);
+
+            const __mmask16 complete = _mm512_mask_cmpeq_epi32_mask(refill,
+                unit, subsequence_units);
+
+            // scatter the sync points of completed subsequences
+            if(complete != 0) {
+                const __m512i index = _mm512_slli_epi32(subsequence, 2);
+                int* base = (int*) sync;
+
+                _mm512_mask_i32scatter_epi32(base, complete, index,
+                    last_state, 4);
+                _mm512_mask_i32scatter_epi32(base + 1, complete, index,
+                    last_bit, 4);
+                _mm512_mask_i32scatter_epi32(base + 2, complete, index,
+                    _mm512_sub_epi32(subsequence_units, one), 4);
+                _mm512_mask_i32scatter_epi32(base + 3, complete, index,
+                    num_symbols, 4);
+
+                subsequence = _mm512_mask_add_epi32(subsequence, complete,
+                    subsequence, one);
+                unit = _mm512_mask_mov_epi32(unit, complete, zero);
+                num_symbols = _mm512_mask_mov_epi32(num_symbols, complete,
+                    zero);
+            }
+
+            active = _mm512_cmpgt_epu32_mask(end, pos);
+            if(active == 0) break;
+
+            load |= refill & active;
+        }
+
+        if(load != 0) {
+            const __m512i lo = _mm512_mask_i32gather_epi32(zero, load,
+                pos, in_ptr, 4);
+            const __m512i hi = _mm512_mask_i32gather_epi32(zero, load,
+                _mm512_add_epi32(pos, one), in_ptr, 4);
+
+            window = _mm512_mask_or_epi32(window, load,
+                _mm512_srlv_epi32(lo, at),
+                _mm512_sllv_epi32(hi, _mm512_sub_epi32(bits_in_unit, at)));
+            next = _mm512_mask_srlv_epi32(next, load, hi, at);
+
+            load = 0;
+        }
+
+        // decode a symbol, see decode_phase1_avx2
+        const __m512i hit = _mm512_mask_i32gather_epi32(zero, active,
+            _mm512_sub_epi32(state, number_of_states), table, 4);
+
+        const __m512i next_state = _mm512_and_si512(hit, state_mask);
+        __m512i taken = _mm512_srli_epi32(hit, 24);
+
+        __m512i current_state = _mm512_add_epi32(
+            _mm512_sllv_epi32(next_state, taken),
+            _mm512_andnot_si512(_mm512_sllv_epi32(mask, taken), window));
+
+        __mmask16 renormalize = _mm512_mask_cmpgt_epu32_mask(active,
+            number_of_states, current_state);
+
+        while(renormalize != 0) {
+            const __m512i bit = _mm512_and_si512(
+                _mm512_srlv_epi32(window, taken), one);
+
+            current_state = _mm512_mask_add_epi32(current_state,
+                renormalize, _mm512_slli_epi32(current_state, 1), bit);
+            taken = _mm512_mask_add_epi32(taken, renormalize, taken, one);
+
+            renormalize = _mm512_mask_cmpgt_epu32_mask(renormalize,
+                number_of_states, current_state);
+        }
+
+        last_state = _mm512_mask_mov_epi32(last_state, active, state);
+        last_bit = _mm512_mask_mov_epi32(last_bit, active, at);
+        state = _mm512_mask_mov_epi32(state, active, current_state);
+        num_symbols = _mm512_mask_add_epi32(num_symbols, active,
+            num_symbols, one);
+        at = _mm512_mask_add_epi32(at, active, at, taken);
+
+        window = _mm512_mask_or_epi32(window, active,
+            _mm512_srlv_epi32(window, taken),
+            _mm512_sllv_epi32(next, _mm512_sub_epi32(bits_in_unit, taken)));
+        next = _mm512_mask_srlv_epi32(next, active, next, taken);
+    }
+}
+
+#endif /* MULTIANS_SIMD */
+
+// the other members are instantiated in multicore_decoder.cc
+#define INSTANTIATE_LANES(TYPES) \
+    template size_t MulticoreBasicDecoder<TYPES>::get_phase1_lanes(); \
+    template void MulticoreBasicDecoder<TYPES>::decode_phase1_simd( \
+        const size_t*, size_t, const std::vector<DecoderInterval>&, \
+        size_t, std::shared_ptr<CUHDBasicInputBuffer<TYPES>>, \
+        std::shared_ptr<CUHDBasicCodetable<TYPES>>, \
+        std::shared_ptr<MulticoreBasicDecoder<TYPES>:: \
+            SubsequenceSyncPoint[]>);
+
+CUHD_FOR_EACH_TYPES(INSTANTIATE_LANES)
@@ -0,0 +1,251 @@
+/*****************************************************************************
+ *
+ * MULTIANS - Massively parallel ANS decoding on GPUs
+ *
+ * released under LGPL-3.0
+ *
+ * 2017-2019 André Weißenberger
+ *
+ *****************************************************************************/
+
+#include "multicore_stream_decoder.h"
+#include "cuhd_bit_io.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+    // each window is written in original order, without a sync index
+    MulticoreDecoderOptions get_window_options(
+        std::shared_ptr<CUHDAllocator> allocator) {
+
+        MulticoreDecoderOptions options;
+        options.sync_mode = MulticoreSyncMode::ROUNDS;
+        options.use_sync_index = false;
+        options.forward_output = true;
+        options.allocator = allocator;
+
+        return options;
+    }
+}
+
+template<typename Types>
+MulticoreBasicStreamDecoder<Types>::MulticoreBasicStreamDecoder(
+    std::shared_ptr<Codetable> tab,
+    size_t num_symbols,
+    size_t first_bit,
+    size_t first_state,
+    std::vector<symbol_type*> buffers,
+    size_t buffer_size,
+    Consumer consumer,
+    size_t window_units,
+    size_t num_threads,
+    size_t subsequence_size,
+    std::shared_ptr<CUHDAllocator> allocator)
+    : tab_(tab),
+      num_symbols_(num_symbols),
+      num_decoded_(0),
+      first_bit_(first_bit),
+      first_state_(first_state),
+      buffers_(buffers),
+      buffer_size_(buffer_size),
+      next_buffer_(0),
+      consumer_(consumer),
+      subsequence_size_(subsequence_size),
+      window_units_(window_units / subsequence_size * subsequence_size),
+      input_size_(0),
+      overflow_size_(0),
+      allocator_(allocator) {
+
+    assert(!buffers.empty() && buffer_size > 0);
+    assert(window_units_ > 0);
+
+    // a full window and the padding behind the units pushed last
+    input_ = CUHDAllocator::allocate_array<unit_type>(
+        window_units_ + 2 * INPUT_BUFFER_PADDING, allocator);
+
+    session_.reset(new Session(num_threads, get_window_options(allocator)));
+
+    if(num_threads > 1) {
+        single_session_.reset(new Session(1, get_window_options(allocator)));
+    }
+}
+
+template<typename Types>
+void MulticoreBasicStreamDecoder<Types>::push(const unit_type* units,
+    size_t count) {
+
+    // the last codewords of a window reach into the units after it
+    const size_t full = window_units_ + INPUT_BUFFER_PADDING;
+
+    while(count > 0) {
+        const size_t n = std::min(count, full - input_size_);
+
+        std::copy(units, units + n, input_.get() + input_size_);
+        input_size_ += n;
+        units += n;
+        count -= n;
+
+        if(input_size_ == full) decode_window(window_units_);
+    }
+}
+
+template<typename Types>
+void MulticoreBasicStreamDecoder<Types>::finish() {
+    unit_type* input = input_.get();
+
+    std::fill(input + input_size_,
+        input + input_size_ + INPUT_BUFFER_PADDING, 0);
+
+    // the remaining symbols may not fit into a single buffer, windows are
+    // split off down to the last subsequence
+    while(num_symbols_ - num_decoded_ > buffer_size_
+        && input_size_ > subsequence_size_) {
+
+        decode_window((input_size_ - 1)
+            / subsequence_size_ * subsequence_size_);
+    }
+
+    decode_last();
+}
+
+template<typename Types>
+size_t MulticoreBasicStreamDecoder<Types>::get_num_decoded() {
+    return num_decoded_;
+}
+
+template<typename Types>
+void MulticoreBasicStreamDecoder<Types>::decode_window(size_t num_units) {
+    unit_type* input = input_.get();
+
+    SubsequenceSyncPoint last;
+    size_t num_window_symbols;
+
+    while(true) {
+        std::shared_ptr<InputBuffer> in = std::make_shared<InputBuffer>(
+            input_, 0, num_units, first_bit_, first_state_);
+
+        num_window_symbols = get_session(num_units).synchronise_window(
+            subsequence_size_, num_units, in, tab_, last);
+
+        // a subsequence with more symbols than a buffer is split in emit()
+        if(num_window_symbols <= buffer_size_
+            || num_units == subsequence_size_) break;
+
+        num_units = std::max(num_units / 2 / subsequence_size_, (size_t) 1)
+            * subsequence_size_;
+    }
+
+    assert(num_decoded_ + num_window_symbols <= num_symbols_);
+
+    get_session(num_units).write_window(std::make_shared<OutputBuffer>(
+        get_output(num_window_symbols), num_window_symbols));
+
+    emit(num_window_symbols);
+
+    // the sync point is the start of the window's last codeword, which ends
+    // in the unit after the window, where the next window starts
+    const size_t number_of_states = tab_->get_num_entries();
+    const size_t bits_in_unit = sizeof(unit_type) * 8;
+    const unit_type mask = (unit_type) (0) - 1;
+
+    const unit_type* at_unit = input + num_units - subsequence_size_
+        + last.unit;
+    const typename Types::window_type window
+        = cuhd::load_window<Types>(at_unit) >> last.bit;
+
+    const CUHDBasicCodetableItem<Types> hit
+        = tab_->get()[last.state - number_of_states];
+
+    size_t taken = hit.min_num_bits;
+    typename Types::state_type state = (hit.next_state << taken)
+        + (~(mask << taken) & window);
+
+    while(state < number_of_states) {
+        state = (state << 1) + ((window >> taken) & 1);
+        ++taken;
+    }
+
+    const size_t end_bit = (num_units - 1) * bits_in_unit + last.bit + taken;
+    assert(end_bit >= num_units * bits_in_unit);
+
+    first_bit_ = (num_units + 1) * bits_in_unit - end_bit;
+    first_state_ = state;
+
+    // keep the units after the window, and the padding if there is one
+    std::copy(input + num_units, input + input_size_ + INPUT_BUFFER_PADDING,
+        input);
+    input_size_ -= num_units;
+}
+
+template<typename Types>
+void MulticoreBasicStreamDecoder<Types>::decode_last() {
+    const size_t num_remaining = num_symbols_ - num_decoded_;
+
+    if(num_remaining == 0) return;
+
+    std::shared_ptr<InputBuffer> in = std::make_shared<InputBuffer>(
+        input_, 0, input_size_, first_bit_, first_state_);
+
+    get_session(input_size_).decode(subsequence_size_, input_size_,
+        std::make_shared<OutputBuffer>(
+            get_output(num_remaining), num_remaining),
+        in, tab_);
+
+    emit(num_remaining);
+}
+
+template<typename Types>
+typename MulticoreBasicStreamDecoder<Types>::symbol_type*
+    MulticoreBasicStreamDecoder<Types>::get_output(size_t num_symbols) {
+
+    if(num_symbols <= buffer_size_) return buffers_[next_buffer_];
+
+    if(num_symbols > overflow_size_) {
+        overflow_ = CUHDAllocator::allocate_array<symbol_type>(
+            num_symbols, allocator_);
+        overflow_size_ = num_symbols;
+    }
+
+    return overflow_.get();
+}
+
+template<typename Types>
+void MulticoreBasicStreamDecoder<Types>::emit(size_t num_symbols) {
+    if(num_symbols <= buffer_size_) {
+        symbol_type* buffer = buffers_[next_buffer_];
+        next_buffer_ = (next_buffer_ + 1) % buffers_.size();
+
+        num_decoded_ += num_symbols;
+
+        consumer_(buffer, num_symbols, num_symbols_ - num_decoded_);
+        return;
+    }
+
+    // the symbols were written into the overflow buffer, they are copied
+    // into the buffers from their end, the order in which chunks arrive
+    while(num_symbols > 0) {
+        const size_t size = std::min(num_symbols, buffer_size_);
+        num_symbols -= size;
+
+        std::copy(overflow_.get() + num_symbols,
+            overflow_.get() + num_symbols + size, buffers_[next_buffer_]);
+
+        emit(size);
+    }
+}
+
+template<typename Types>
+typename MulticoreBasicStreamDecoder<Types>::Session&
+    MulticoreBasicStreamDecoder<Types>::get_session(size_t num_units) {
+
+    const size_t num_subsequences = (num_units + subsequence_size_ - 1)
+        / subsequence_size_;
+
+    if(num_subsequences < session_->get_num_threads()) return *single_session_;
+
+    return *session_;
+}
+
+CUHD_INSTANTIATE(MulticoreBasicStreamDecoder)